@@ -0,0 +1,102 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+// Measures text scanning of inja lexer on large, mostly static templates
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <format>
+#include <print>
+#include <string>
+#include <string_view>
+
+#include <inja/inja.hpp>
+
+namespace {
+
+constexpr std::size_t iterations = 200;
+
+/// CSS-like template: many `{` and `#` in static text, one expression per rule
+auto make_template(std::size_t rules) -> std::string {
+  std::string result;
+  for (std::size_t i = 0; i < rules; ++i) {
+    result += std::format(".widget-{} {{\n  border: 1px solid #20242c;\n  background: #1f1f28;\n", i);
+    result += "  color: {{ palette.base05 }};\n}\n\n";
+  }
+  return result;
+}
+
+/// Average time of fn call in microseconds
+template <typename Fn>
+auto measure(Fn&& fn) -> double {
+  std::size_t sink = 0;
+  auto const start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    sink += fn();
+  }
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  if (sink == 0) {
+    std::print(stderr, "nothing scanned\n");
+  }
+  return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+/// Count candidates of whole text with given scanner
+template <typename Find>
+auto count_candidates(std::string_view text, Find&& find) -> std::size_t {
+  std::size_t result = 0;
+  for (auto pos = find(text); pos != std::string_view::npos; pos = find(text)) {
+    ++result;
+    text.remove_prefix(pos + 1);
+  }
+  return result;
+}
+
+} // namespace
+
+auto main() -> int {
+  inja::LexerConfig config;
+  config.update_open_chars();
+
+  inja::Environment env;
+  env.set_trim_blocks(true);
+  env.set_lstrip_blocks(true);
+
+#if defined(__AVX2__)
+  std::print(stdout, "pair scanner: AVX2\n");
+#elif defined(__SSE2__)
+  std::print(stdout, "pair scanner: SSE2\n");
+#else
+  std::print(stdout, "pair scanner: scalar\n");
+#endif
+  std::print(stdout, "{:>10} {:>10} {:>10} {:>12} {:>12} {:>12}\n", "size", "chars", "pairs", "scan chars",
+      "scan pairs", "parse");
+
+  for (std::size_t const rules : {100, 1000, 10000}) {
+    auto const text = make_template(rules);
+
+    std::size_t chars = 0;
+    std::size_t pairs = 0;
+    auto const chars_us = measure([&] {
+      chars = count_candidates(text, [&](std::string_view str) {
+        return str.find_first_of(config.open_chars);
+      });
+      return chars;
+    });
+    auto const pairs_us = measure([&] {
+      pairs = count_candidates(text, [&](std::string_view str) {
+        return inja::find_first_pair(str, config.open_pairs);
+      });
+      return pairs;
+    });
+    auto const parse_us = measure([&] {
+      return env.parse(text).content.size();
+    });
+
+    std::print(stdout, "{:>10} {:>10} {:>10} {:>9.1f} us {:>9.1f} us {:>9.1f} us\n", text.size(), chars, pairs,
+        chars_us, pairs_us, parse_us);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,172 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+// Measures time to exit of no-op applies: the same theme is applied again, so every item is skipped
+// walng runs in a scratch home with its own config, theme, templates and cache; usage: walng-startup-bench [WALNG]
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <print>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t warmup_runs = 3;
+constexpr std::size_t runs = 50;
+
+constexpr std::string_view theme_yaml = R"(system: "base16"
+name: "Startup"
+author: "walng"
+variant: "dark"
+palette:
+  base00: "#1d2021"
+  base01: "#3c3836"
+  base02: "#504945"
+  base03: "#665c54"
+  base04: "#bdae93"
+  base05: "#d5c4a1"
+  base06: "#ebdbb2"
+  base07: "#fbf1c7"
+  base08: "#fb4934"
+  base09: "#fe8019"
+  base0A: "#fabd2f"
+  base0B: "#b8bb26"
+  base0C: "#8ec07c"
+  base0D: "#83a598"
+  base0E: "#d3869b"
+  base0F: "#d65d0e"
+)";
+
+constexpr std::string_view inja_template = R"(* {
+{% for name, color in palette %}
+  --{{ name }}: {{ color }};
+  --{{ name }}-rgb: {{ rgb(color) }};
+{% endfor %}
+}
+)";
+
+constexpr std::string_view native_template = R"([colors]
+background={{ palette.base00 }}
+foreground={{ palette.base05 }}
+)";
+
+auto write(std::filesystem::path const& path, std::string_view content) -> void {
+  std::filesystem::create_directories(path.parent_path());
+  std::ofstream(path) << content;
+}
+
+/// Run walng with scratch home, wall time of run in milliseconds
+auto run(std::string const& walng, std::filesystem::path const& home) -> std::expected<double, std::string> {
+  auto const config = (home / "config.yaml").string();
+  auto const theme = (home / "theme.yaml").string();
+  std::vector<std::string> args = {walng, "--config", config, "--theme", theme};
+  std::vector<char*> argv;
+  for (auto& arg : args) {
+    argv.push_back(arg.data());
+  }
+  argv.push_back(nullptr);
+
+  std::vector<std::string> env = {"HOME=" + home.string(), "XDG_CONFIG_HOME=" + (home / ".config").string(),
+      "XDG_CACHE_HOME=" + (home / ".cache").string()};
+  std::vector<char*> envp;
+  for (auto& value : env) {
+    envp.push_back(value.data());
+  }
+  envp.push_back(nullptr);
+
+  posix_spawn_file_actions_t actions;
+  ::posix_spawn_file_actions_init(&actions);
+  ::posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+  ::posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+  auto const start = std::chrono::steady_clock::now();
+  pid_t pid;
+  auto const rc = ::posix_spawn(&pid, walng.c_str(), &actions, nullptr, argv.data(), envp.data());
+  ::posix_spawn_file_actions_destroy(&actions);
+  if (rc != 0) {
+    return std::unexpected(std::format("can't run '{}'", walng));
+  }
+  int status = 0;
+  if (::waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    return std::unexpected(std::format("'{}' failed", walng));
+  }
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+auto main(int argc, char* argv[]) -> int {
+#if defined(WALNG_BINARY)
+  std::string const walng = argc > 1 ? argv[1] : WALNG_BINARY;
+#else
+  if (argc < 2) {
+    std::print(stderr, "usage: {} WALNG\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  std::string const walng = argv[1];
+#endif
+
+  std::string scratch = (std::filesystem::temp_directory_path() / "walng-startup-XXXXXX").string();
+  if (!::mkdtemp(scratch.data())) {
+    std::print(stderr, "can't create scratch directory\n");
+    return EXIT_FAILURE;
+  }
+  std::filesystem::path const home = scratch;
+
+  write(home / "theme.yaml", theme_yaml);
+  write(home / "templates" / "colors.css", inja_template);
+  write(home / "templates" / "colors.ini", native_template);
+  auto const root = home.string();
+  write(home / "config.yaml", std::format(R"(items:
+  - name: "css"
+    template: "{}/templates/colors.css"
+    target: "{}/out/colors.css"
+  - name: "ini"
+    template: "{}/templates/colors.ini"
+    target: "{}/out/colors.ini"
+    engine: "native"
+)",
+                                  root, root, root, root));
+
+  std::vector<double> times;
+  std::string error;
+  for (std::size_t i = 0; i < warmup_runs + runs && error.empty(); ++i) {
+    if (auto const elapsed = run(walng, home); !elapsed) {
+      error = elapsed.error();
+    } else if (i >= warmup_runs) {
+      times.push_back(*elapsed);
+    }
+  }
+
+  std::error_code ec;
+  std::filesystem::remove_all(home, ec);
+
+  if (!error.empty()) {
+    std::print(stderr, "{}\n", error);
+    return EXIT_FAILURE;
+  }
+
+  std::ranges::sort(times);
+  double total = 0.0;
+  for (auto const value : times) {
+    total += value;
+  }
+  std::print(stdout, "no-op apply, {} runs: min {:.2f} ms, median {:.2f} ms, mean {:.2f} ms\n", times.size(),
+      times.front(), times[times.size() / 2], total / static_cast<double>(times.size()));
+
+  return EXIT_SUCCESS;
+}
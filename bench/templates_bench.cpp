@@ -0,0 +1,139 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+// Compares rendering of built-in templates: inja (parse + render, render of parsed template), bytecode program and
+// build-time compiled render function; placeholder-only template is also rendered by native engine
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <print>
+#include <string>
+#include <string_view>
+
+#include <inja/inja.hpp>
+
+import walng.basexx_theme;
+import walng.builtin_templates;
+import walng.color;
+import walng.native_template;
+import walng.render;
+import walng.template_vm;
+
+namespace {
+
+constexpr std::size_t iterations = 20000;
+
+auto make_theme() -> walng::basexx_theme {
+  walng::basexx_theme result;
+  result.name = "Bench";
+  result.author = "walng";
+  result.variant = "dark";
+  result.system = "base24";
+  for (std::uint32_t index = 0; index < 24; ++index) {
+    result.palette.push_back(walng::color{0x102030u + index * 0x070503u});
+  }
+  return result;
+}
+
+/// Typical placeholder-only template: color definitions of every slot
+auto make_placeholder_template() -> std::string {
+  std::string result = "/* {{ name }} by {{ author }} */\n";
+  for (std::size_t index = 0; index < 24; ++index) {
+    auto const slot = walng::basexx_theme_color_name(index);
+    result += std::format("@define-color {} {{{{ palette.{} }}}};\n", slot, slot);
+  }
+  return result;
+}
+
+/// Average time of fn call in nanoseconds
+template <typename Fn>
+auto measure(Fn&& fn) -> double {
+  std::size_t size = 0;
+  auto const start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < iterations; ++i) {
+    size += fn().size();
+  }
+  auto const elapsed = std::chrono::steady_clock::now() - start;
+  if (size == 0) {
+    std::print(stderr, "empty output\n");
+  }
+  return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+} // namespace
+
+auto main() -> int {
+  try {
+    auto env = walng::get_inja_env();
+    auto const theme = make_theme();
+    walng::theme_data_provider const data(theme);
+
+    std::print(stdout, "{:<24} {:>14} {:>14} {:>14} {:>14}\n", "template", "inja parse", "inja render", "bytecode",
+        "builtin");
+    for (auto const& builtin : walng::get_builtin_templates()) {
+      auto const tmpl = env.parse(builtin.source);
+      auto const program = walng::template_program::compile(tmpl);
+
+      std::string expected;
+      builtin.render(data, expected);
+      if (env.render(tmpl, data.data(), data) != expected) {
+        std::print(stderr, "{}: builtin output differs from inja\n", builtin.name);
+        return EXIT_FAILURE;
+      }
+
+      auto const parse_ns = measure([&] {
+        return env.render(env.parse(builtin.source), data.data(), data);
+      });
+      auto const render_ns = measure([&] {
+        return env.render(tmpl, data.data(), data);
+      });
+      double program_ns = 0.0;
+      if (program) {
+        program_ns = measure([&] {
+          return program->render(data);
+        });
+      }
+      auto const builtin_ns = measure([&] {
+        std::string result;
+        builtin.render(data, result);
+        return result;
+      });
+
+      std::print(stdout, "{:<24} {:>11.0f} ns {:>11.0f} ns {:>11.0f} ns {:>11.0f} ns\n", builtin.name, parse_ns,
+          render_ns, program_ns, builtin_ns);
+    }
+
+    auto const source = make_placeholder_template();
+    auto const tmpl = env.parse(source);
+    auto const program = walng::template_program::compile(tmpl);
+    auto const native = walng::native_template::parse(source);
+    if (!program || !native) {
+      std::print(stderr, "placeholders: can't compile template\n");
+      return EXIT_FAILURE;
+    }
+    if (native->render(data) != env.render(tmpl, data.data(), data)) {
+      std::print(stderr, "placeholders: native output differs from inja\n");
+      return EXIT_FAILURE;
+    }
+    auto const render_ns = measure([&] {
+      return env.render(tmpl, data.data(), data);
+    });
+    auto const program_ns = measure([&] {
+      return program->render(data);
+    });
+    auto const native_ns = measure([&] {
+      return native->render(data);
+    });
+    std::print(stdout, "\n{:<24} {:>14} {:>14} {:>14}\n", "template", "inja render", "bytecode", "native");
+    std::print(stdout, "{:<24} {:>11.0f} ns {:>11.0f} ns {:>11.0f} ns\n", "placeholders", render_ns, program_ns,
+        native_ns);
+  } catch (std::exception const& e) {
+    std::print(stderr, "{}\n", e.what());
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,85 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#ifndef WALNG_WALNG_H
+#define WALNG_WALNG_H
+
+/// walng C API
+///
+/// Objects are opaque handles created by *_load functions and released by matching *_free functions. Functions
+/// returning walng_status never throw; on failure message of the last error of calling thread is available through
+/// walng_last_error(). Handles may be shared between threads for reading, every function only reads its handles.
+
+#include <stddef.h>
+
+#if defined(WALNG_C_BUILD)
+#define WALNG_API __attribute__((visibility("default")))
+#else
+#define WALNG_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Version of this API, incremented on incompatible changes
+#define WALNG_API_VERSION 1
+
+typedef enum walng_status {
+  WALNG_OK = 0,
+  /// Operation failed, see walng_last_error()
+  WALNG_ERROR = 1,
+  /// Output doesn't fit caller buffer, required size is reported
+  WALNG_BUFFER_TOO_SMALL = 2,
+} walng_status;
+
+typedef enum walng_engine {
+  /// Full template language
+  WALNG_ENGINE_INJA = 0,
+  /// Placeholder substitution only
+  WALNG_ENGINE_NATIVE = 1,
+} walng_engine;
+
+/// walng configuration (items and hooks)
+typedef struct walng_config walng_config;
+
+/// base16 / base24 theme
+typedef struct walng_theme walng_theme;
+
+/// WALNG_API_VERSION of library
+WALNG_API int walng_api_version(void);
+
+/// walng version string
+WALNG_API const char* walng_version(void);
+
+/// Message of error of the last walng_status call of this thread, empty string if it succeeded
+WALNG_API const char* walng_last_error(void);
+
+/// Load config file, "~/" in template and target paths is expanded
+WALNG_API walng_status walng_config_load(const char* path, walng_config** config);
+
+WALNG_API void walng_config_free(walng_config* config);
+
+/// Load theme from yaml file
+WALNG_API walng_status walng_theme_load_file(const char* path, walng_theme** theme);
+
+/// Load theme from yaml content
+WALNG_API walng_status walng_theme_load_buffer(const char* data, size_t size, walng_theme** theme);
+
+WALNG_API void walng_theme_free(walng_theme* theme);
+
+/// Render every config item with theme, write targets and run hooks
+/// Failed items don't stop the rest, the first failure is reported.
+WALNG_API walng_status walng_apply(const walng_config* config, const walng_theme* theme);
+
+/// Render template source with theme into caller buffer
+/// Output is not NUL-terminated, its size is stored to output_size. When output is larger than buffer_size nothing is
+/// written and WALNG_BUFFER_TOO_SMALL is returned with required size in output_size.
+WALNG_API walng_status walng_render(const walng_theme* theme, const char* source, size_t source_size,
+    walng_engine engine, char* buffer, size_t buffer_size, size_t* output_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // WALNG_WALNG_H
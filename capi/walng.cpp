@@ -0,0 +1,161 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <cstddef>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <utility>
+
+#include <walng/walng.h>
+
+import walng.apply;
+import walng.basexx_theme;
+import walng.config;
+import walng.version;
+
+struct walng_config {
+  walng::config value;
+};
+
+struct walng_theme {
+  walng::basexx_theme value;
+};
+
+namespace {
+
+thread_local std::string last_error;
+
+auto fail(std::string error) noexcept -> walng_status {
+  try {
+    last_error = std::move(error);
+  } catch (...) {
+    last_error.clear();
+  }
+  return WALNG_ERROR;
+}
+
+/// Run fn, exceptions are reported as errors instead of crossing the boundary
+/// Error of previous call is cleared first, so walng_last_error() always describes the last call.
+template <typename Fn>
+auto guarded(Fn&& fn) noexcept -> walng_status {
+  last_error.clear();
+  try {
+    return fn();
+  } catch (std::exception const& e) {
+    return fail(e.what());
+  } catch (...) {
+    return fail("unknown error");
+  }
+}
+
+} // namespace
+
+extern "C" {
+
+int walng_api_version(void) {
+  return WALNG_API_VERSION;
+}
+
+char const* walng_version(void) {
+  return walng::version.data();
+}
+
+char const* walng_last_error(void) {
+  return last_error.c_str();
+}
+
+walng_status walng_config_load(char const* path, walng_config** config) {
+  return guarded([&] {
+    if (!path || !config) {
+      return fail("invalid argument");
+    }
+    auto result = walng::load_config_from_yaml_file(path);
+    if (!result) {
+      return fail(std::move(result.error()));
+    }
+    *config = new walng_config{std::move(result.value())};
+    return WALNG_OK;
+  });
+}
+
+void walng_config_free(walng_config* config) {
+  delete config;
+}
+
+walng_status walng_theme_load_file(char const* path, walng_theme** theme) {
+  return guarded([&] {
+    if (!path || !theme) {
+      return fail("invalid argument");
+    }
+    auto result = walng::basexx_theme_parse_from_yaml_file(path);
+    if (!result) {
+      return fail(std::move(result.error()));
+    }
+    *theme = new walng_theme{std::move(result.value())};
+    return WALNG_OK;
+  });
+}
+
+walng_status walng_theme_load_buffer(char const* data, size_t size, walng_theme** theme) {
+  return guarded([&] {
+    if ((!data && size != 0) || !theme) {
+      return fail("invalid argument");
+    }
+    auto result = walng::basexx_theme_parse_from_yaml_content(std::string(data, size));
+    if (!result) {
+      return fail(std::move(result.error()));
+    }
+    *theme = new walng_theme{std::move(result.value())};
+    return WALNG_OK;
+  });
+}
+
+void walng_theme_free(walng_theme* theme) {
+  delete theme;
+}
+
+walng_status walng_apply(walng_config const* config, walng_theme const* theme) {
+  return guarded([&] {
+    if (!config || !theme) {
+      return fail("invalid argument");
+    }
+    auto const report = walng::apply_config(config->value, theme->value);
+    if (!report) {
+      return fail(report.error());
+    }
+    for (auto const& item : report->items) {
+      if (!item.error.empty()) {
+        return fail(item.error);
+      }
+    }
+    return WALNG_OK;
+  });
+}
+
+walng_status walng_render(walng_theme const* theme, char const* source, size_t source_size, walng_engine engine,
+    char* buffer, size_t buffer_size, size_t* output_size) {
+  return guarded([&] {
+    if (!theme || (!source && source_size != 0) || (!buffer && buffer_size != 0) || !output_size ||
+        (engine != WALNG_ENGINE_INJA && engine != WALNG_ENGINE_NATIVE)) {
+      return fail("invalid argument");
+    }
+    walng::apply_template const templates[] = {{"", std::string(source, source_size),
+        engine == WALNG_ENGINE_NATIVE ? walng::template_engine::native : walng::template_engine::inja}};
+    auto const outputs = walng::apply(templates, theme->value);
+    auto const& output = outputs.front();
+    if (!output.error.empty()) {
+      return fail(output.error);
+    }
+    *output_size = output.content.size();
+    if (output.content.size() > buffer_size) {
+      return WALNG_BUFFER_TOO_SMALL;
+    }
+    if (!output.content.empty()) {
+      std::memcpy(buffer, output.content.data(), output.content.size());
+    }
+    return WALNG_OK;
+  });
+}
+
+} // extern "C"
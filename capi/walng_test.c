@@ -0,0 +1,73 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <stdio.h>
+#include <string.h>
+
+#include <walng/walng.h>
+
+#define CHECK(expr)                                                                                                    \
+  do {                                                                                                                 \
+    if (!(expr)) {                                                                                                     \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr);                                         \
+      return 1;                                                                                                        \
+    }                                                                                                                  \
+  } while (0)
+
+static const char theme_yaml[] = "system: base16\n"
+                                 "name: test\n"
+                                 "author: test\n"
+                                 "variant: dark\n"
+                                 "palette:\n"
+                                 "  base00: \"#000000\"\n"
+                                 "  base01: \"#111111\"\n"
+                                 "  base02: \"#222222\"\n"
+                                 "  base03: \"#333333\"\n"
+                                 "  base04: \"#444444\"\n"
+                                 "  base05: \"#555555\"\n"
+                                 "  base06: \"#666666\"\n"
+                                 "  base07: \"#777777\"\n"
+                                 "  base08: \"#888888\"\n"
+                                 "  base09: \"#999999\"\n"
+                                 "  base0A: \"#aaaaaa\"\n"
+                                 "  base0B: \"#bbbbbb\"\n"
+                                 "  base0C: \"#cccccc\"\n"
+                                 "  base0D: \"#dddddd\"\n"
+                                 "  base0E: \"#eeeeee\"\n"
+                                 "  base0F: \"#ffffff\"\n";
+
+int main(void) {
+  CHECK(walng_api_version() == WALNG_API_VERSION);
+  CHECK(strlen(walng_version()) > 0);
+  CHECK(strcmp(walng_last_error(), "") == 0);
+
+  walng_theme* theme = NULL;
+  CHECK(walng_theme_load_buffer("palette: [", 10, &theme) == WALNG_ERROR);
+  CHECK(theme == NULL);
+  CHECK(strlen(walng_last_error()) > 0);
+
+  // successful call clears error of the previous one
+  CHECK(walng_theme_load_buffer(theme_yaml, sizeof(theme_yaml) - 1, &theme) == WALNG_OK);
+  CHECK(theme != NULL);
+  CHECK(strcmp(walng_last_error(), "") == 0);
+
+  static const char source[] = "{{ name }}: {{ palette.base0A }}";
+  static const char expected[] = "test: #aaaaaa";
+  char buffer[64];
+  size_t size = 0;
+  CHECK(walng_render(theme, source, sizeof(source) - 1, WALNG_ENGINE_NATIVE, buffer, 4, &size) ==
+        WALNG_BUFFER_TOO_SMALL);
+  CHECK(size == sizeof(expected) - 1);
+  CHECK(walng_render(theme, source, sizeof(source) - 1, WALNG_ENGINE_NATIVE, buffer, sizeof(buffer), &size) ==
+        WALNG_OK);
+  CHECK(size == sizeof(expected) - 1 && memcmp(buffer, expected, size) == 0);
+  CHECK(walng_render(theme, source, sizeof(source) - 1, WALNG_ENGINE_INJA, buffer, sizeof(buffer), &size) == WALNG_OK);
+  CHECK(size == sizeof(expected) - 1 && memcmp(buffer, expected, size) == 0);
+
+  CHECK(walng_render(NULL, source, sizeof(source) - 1, WALNG_ENGINE_INJA, buffer, sizeof(buffer), &size) ==
+        WALNG_ERROR);
+  CHECK(strcmp(walng_last_error(), "invalid argument") == 0);
+
+  walng_theme_free(theme);
+  return 0;
+}
@@ -0,0 +1,444 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <inja/inja.hpp>
+
+import walng.basexx_theme;
+import walng.builtin_templates;
+import walng.config;
+import walng.hash;
+import walng.history;
+import walng.include_cache;
+import walng.native_template;
+import walng.prerender;
+import walng.render;
+import walng.render_cache;
+import walng.store;
+import walng.template_vm;
+import walng.utils;
+
+module walng.apply;
+
+namespace walng {
+namespace {
+
+/// Load history of applied outputs, history is optional so failures are only reported
+auto load_history(std::size_t history_size, apply_report& report) -> std::optional<history> {
+  if (history_size == 0) {
+    return std::nullopt;
+  }
+  auto const history_path = get_history_path();
+  if (!history_path) {
+    report.warnings.push_back(std::format("failed to get history path ({})", history_path.error()));
+    return std::nullopt;
+  }
+  auto result = history::load(*history_path);
+  if (!result) {
+    report.warnings.push_back(std::format("failed to load history ({})", result.error()));
+    return std::nullopt;
+  }
+  return {std::move(result.value())};
+}
+
+auto save_generation(std::optional<history>& history, generation value, std::size_t history_size,
+    apply_report& report) -> void {
+  if (!history) {
+    return;
+  }
+  if (auto const rc = history->push(std::move(value), history_size); !rc) {
+    report.warnings.push_back(std::format("failed to save history ({})", rc.error()));
+  }
+}
+
+/// Write rendered content to target, through history blob store when history is kept
+auto install_content(std::optional<history> const& history, std::filesystem::path const& target_path,
+    std::span<std::string_view const> content) -> std::expected<std::uint64_t, std::string> {
+  if (!history) {
+    return write_file(target_path, content).transform([] {
+      return std::uint64_t(0);
+    });
+  }
+  auto const blob_hash = history->store().put(content);
+  if (!blob_hash) {
+    return std::unexpected(blob_hash.error());
+  }
+  if (auto const rc = install_file_atomic(history->store().path(*blob_hash), target_path); !rc) {
+    return std::unexpected(rc.error());
+  }
+  return *blob_hash;
+}
+
+/// Entry of config item in generation
+auto find_generation_entry(generation const* generation, application_template const& item)
+    -> generation_entry const* {
+  if (!generation) {
+    return nullptr;
+  }
+  for (auto const& entry : generation->entries) {
+    if (entry.name == item.name && entry.target_path == item.target_path) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+/// Check file still has content with given hash (wasn't modified since written)
+auto is_file_content(std::filesystem::path const& path, std::uint64_t hash) -> bool {
+  auto const content = read_file(path);
+  return content && hash_string(*content) == hash;
+}
+
+auto add_item_result(apply_report& report, apply_options const& options, apply_item_result result) -> void {
+  if (options.on_item) {
+    options.on_item(result);
+  }
+  report.items.push_back(std::move(result));
+}
+
+/// Installed item waiting for its hook
+struct pending_hook {
+  apply_item_result result;
+  std::string const* hook_cmd;
+};
+
+/// Report installed item, item with hook is reported once its hook has run
+auto add_installed_item(apply_report& report, apply_options const& options, std::vector<pending_hook>& hooks,
+    apply_item_result result, std::string const& hook_cmd) -> void {
+  if (hook_cmd.empty()) {
+    add_item_result(report, options, std::move(result));
+  } else {
+    hooks.push_back(pending_hook{std::move(result), &hook_cmd});
+  }
+}
+
+/// Run hooks of installed items, failure is reported as error of item
+///
+/// Hooks may be slow, they run after history is saved and released so other instances aren't blocked on its lock.
+auto run_hooks(config const& config, apply_options const& options, std::vector<pending_hook>& hooks,
+    apply_report& report) -> void {
+  for (auto& hook : hooks) {
+    if (auto const rc = execute_hook(config.shell_exec_cmd, *hook.hook_cmd); !rc) {
+      hook.result.error = std::format("failed to execute hook ({})", rc.error());
+    }
+    add_item_result(report, options, std::move(hook.result));
+  }
+}
+
+/// Install prerendered outputs of theme and run hooks, fails if there is no valid prerendered set
+auto apply_prerendered(config const& config, basexx_theme const& theme, apply_options const& options,
+    apply_report& report) -> std::expected<void, std::string> {
+  auto const prerender_path = get_prerender_path();
+  if (!prerender_path) {
+    return std::unexpected(prerender_path.error());
+  }
+  blob_store const store(*prerender_path / "blobs");
+
+  auto const set = load_prerender_set(*prerender_path, get_prerender_set_key(config, theme));
+  if (!set) {
+    return std::unexpected(set.error());
+  }
+  if (auto const rc = validate_prerender_set(*set, config, store); !rc) {
+    return std::unexpected(rc.error());
+  }
+
+  report.prerendered = true;
+  auto history = load_history(options.history_size, report);
+  generation generation;
+  generation.theme = theme;
+  std::vector<pending_hook> hooks;
+
+  for (std::size_t i = 0; i < config.items.size(); ++i) {
+    auto const& item = config.items[i];
+    auto const blob_hash = set->entries[i].blob_hash;
+    apply_item_result result{item.name, apply_item_status::installed, {}};
+
+    if (auto const rc = install_file_atomic(store.path(blob_hash), item.target_path); !rc) {
+      result.status = apply_item_status::failed;
+      result.error = std::format("failed to install '{}' ({})", item.target_path.c_str(), rc.error());
+      add_item_result(report, options, std::move(result));
+      continue;
+    }
+    // blobs of both stores are named by content hash, copy is shared by reflink when possible
+    if (history && !history->store().contains(blob_hash)) {
+      auto const& blobs = history->store();
+      if (auto const rc = install_file_atomic(store.path(blob_hash), blobs.path(blob_hash), blobs.mode()); !rc) {
+        report.warnings.push_back(
+            std::format("failed to save '{}' in history ({})", item.target_path.c_str(), rc.error()));
+      }
+    }
+    generation.entries.push_back(
+        generation_entry{item.name, item.target_path, set->entries[i].template_hash, blob_hash, item.hook_cmd});
+
+    add_installed_item(report, options, hooks, std::move(result), item.hook_cmd);
+  }
+
+  save_generation(history, std::move(generation), options.history_size, report);
+  history.reset();
+  run_hooks(config, options, hooks, report);
+
+  return {};
+}
+
+} // namespace
+
+auto compile_template(inja::Environment& env, application_template const& item, std::string_view content)
+    -> compiled_template {
+  compiled_template result;
+  if (item.engine == template_engine::native) {
+    auto native = native_template::parse(content);
+    if (!native) {
+      throw std::runtime_error(native.error());
+    }
+    result.native = std::move(native.value());
+    return result;
+  }
+  // built-in templates are rendered by generated code, their source is never parsed
+  result.builtin = find_builtin_template(item.template_path);
+  if (result.builtin) {
+    return result;
+  }
+  result.tmpl = item.template_path.empty() ? env.parse(content) : parse_template(env, item.template_path);
+  if (auto program = template_program::compile(*result.tmpl); program) {
+    result.program = std::move(program.value());
+  }
+  return result;
+}
+
+auto render_template_into(std::string& output, inja::Environment& env, compiled_template const& compiled,
+    theme_data_provider const& data) -> void {
+  if (compiled.native) {
+    compiled.native->render_to(output, data);
+  } else if (compiled.builtin) {
+    compiled.builtin->render(data, output);
+  } else if (compiled.program) {
+    compiled.program->render_to(output, data);
+  } else {
+    env.render_into(output, *compiled.tmpl, data.data(), &data);
+  }
+}
+
+auto execute_hook(std::string const& shell_exec_cmd, std::string const& hook_cmd) -> std::expected<void, std::string> {
+  auto const found = shell_exec_cmd.find("{}");
+  if (found == shell_exec_cmd.npos) {
+    return std::unexpected("shell command without placeholder");
+  }
+
+  auto const command_to_execute =
+      std::string().append(shell_exec_cmd, 0, found).append(hook_cmd).append(shell_exec_cmd, found + 2);
+  if (auto const rc = ::system(command_to_execute.c_str()); rc == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+
+  return {};
+}
+
+auto apply(std::span<apply_template const> templates, basexx_theme const& theme) -> std::vector<apply_output> {
+  theme_data_provider const data(theme);
+  include_cache includes;
+  auto env = get_inja_env(data.memo());
+  includes.attach(env);
+
+  std::vector<apply_output> result;
+  result.reserve(templates.size());
+  for (auto const& input : templates) {
+    auto& output = result.emplace_back();
+    output.name = input.name;
+    try {
+      application_template item;
+      item.name = input.name;
+      item.engine = input.engine;
+      render_template_into(output.content, env, compile_template(env, item, input.source), data);
+    } catch (std::exception const& e) {
+      output.content.clear();
+      output.error = e.what();
+    }
+  }
+  return result;
+}
+
+auto apply_config(config const& config, basexx_theme const& theme, apply_options const& options)
+    -> std::expected<apply_report, std::string> {
+  apply_report report;
+  if (options.prerendered) {
+    if (auto const rc = apply_prerendered(config, theme, options, report); rc) {
+      return {std::move(report)};
+    }
+    // missing or outdated prerendered set, render as usual
+    report = apply_report();
+  }
+
+  try {
+    // theme data and template environment are built by the first item which needs them, applies which only skip
+    // items never build them
+    std::optional<theme_data_provider> data;
+    auto const get_data = [&]() -> theme_data_provider const& {
+      if (!data) {
+        data.emplace(theme);
+      }
+      return *data;
+    };
+    // partials shared by items are parsed once per apply
+    include_cache includes;
+    std::optional<inja::Environment> env;
+    auto const get_env = [&]() -> inja::Environment& {
+      if (!env) {
+        env.emplace(get_inja_env(get_data().memo()));
+        includes.attach(*env);
+      }
+      return *env;
+    };
+    // rendered item, reused between items
+    std::string content;
+    template_spans folded;
+
+    auto history = load_history(options.history_size, report);
+    generation generation;
+    generation.theme = theme;
+    std::vector<pending_hook> hooks;
+
+    // items which don't read changed theme data keep output of previous generation
+    auto const* previous = history && !history->generations().empty() ? &history->generations().back() : nullptr;
+    auto const changed = previous ? diff_themes(previous->theme, theme) : theme_usage_all;
+
+    for (auto const& item : config.items) {
+      apply_item_result result{item.name, apply_item_status::rendered, {}};
+      auto const fail = [&](std::string error) {
+        result.status = apply_item_status::failed;
+        result.error = std::move(error);
+        add_item_result(report, options, std::move(result));
+      };
+
+      try {
+        auto const template_content = read_template(item.template_path);
+        if (!template_content) {
+          fail(std::format("failed to read template '{}' ({})", item.template_path.c_str(), template_content.error()));
+          continue;
+        }
+        // includes are part of template, editing a partial must not skip items using it; templates whose includes
+        // can't be resolved are never skipped
+        auto const tree_hash = hash_template_tree(item.template_path);
+        auto const template_hash = tree_hash.value_or(hash_string(*template_content));
+
+        std::optional<native_template> native;
+        if (item.engine == template_engine::native) {
+          auto parsed = native_template::parse(*template_content);
+          if (!parsed) {
+            fail(std::format("failed to parse template of item '{}' ({})", item.name, parsed.error()));
+            continue;
+          }
+          native = std::move(parsed.value());
+        }
+
+        std::optional<inja::Template> tmpl;
+        auto const* entry = tree_hash ? find_generation_entry(previous, item) : nullptr;
+        if (entry && entry->template_hash == template_hash) {
+          theme_usage usage;
+          if (native) {
+            usage = native->usage();
+          } else if (!changed.empty()) {
+            // nothing reads unchanged theme, template isn't parsed then
+            tmpl = parse_template(get_env(), item.template_path);
+            usage = analyze_template(*tmpl, get_env(), includes);
+          }
+          if (!usage.intersects(changed) && is_file_content(item.target_path, entry->blob_hash)) {
+            generation.entries.push_back(*entry);
+            result.status = apply_item_status::skipped;
+            add_item_result(report, options, std::move(result));
+            continue;
+          }
+        }
+
+        // generate and replace target atomically, previous content stays in history
+        std::expected<std::uint64_t, std::string> blob_hash;
+        if (native) {
+          // placeholder substitution is cheaper than a render cache lookup
+          content.clear();
+          native->render_to(content, get_data());
+          std::string_view const spans[] = {content};
+          blob_hash = install_content(history, item.target_path, spans);
+        } else if (auto const* builtin = find_builtin_template(item.template_path); builtin) {
+          // generated render function is cheaper than a render cache lookup
+          content.clear();
+          builtin->render(get_data(), content);
+          std::string_view const spans[] = {content};
+          blob_hash = install_content(history, item.target_path, spans);
+        } else if (options.cache) {
+          std::string cache_error;
+          std::string const cached = options.cache->get_or_render(
+              item.template_path, theme,
+              [&] {
+                if (!tmpl) {
+                  tmpl = parse_template(get_env(), item.template_path);
+                }
+                return get_env().render(*tmpl, get_data().data(), get_data());
+              },
+              &cache_error);
+          if (!cache_error.empty()) {
+            report.warnings.push_back(std::format("failed to store render cache entry ({})", cache_error));
+          }
+          std::string_view const spans[] = {cached};
+          blob_hash = install_content(history, item.target_path, spans);
+        } else {
+          if (!tmpl) {
+            tmpl = parse_template(get_env(), item.template_path);
+          }
+          // theme is fixed, template folds to text spans written without concatenation
+          if (auto const program = template_program::compile(*tmpl); program) {
+            program->evaluate_into(folded, get_data());
+            blob_hash = install_content(history, item.target_path, folded.spans);
+          } else {
+            content.clear();
+            get_env().render_into(content, *tmpl, get_data().data(), &get_data());
+            std::string_view const spans[] = {content};
+            blob_hash = install_content(history, item.target_path, spans);
+          }
+        }
+        if (!blob_hash) {
+          fail(std::format("failed to write '{}' ({})", item.target_path.c_str(), blob_hash.error()));
+          continue;
+        }
+        generation.entries.push_back(
+            generation_entry{item.name, item.target_path, template_hash, *blob_hash, item.hook_cmd});
+
+        add_installed_item(report, options, hooks, std::move(result), item.hook_cmd);
+      } catch (std::exception const& e) {
+        fail(std::format("failed to render item '{}' ({})", item.name, e.what()));
+      }
+    }
+
+    save_generation(history, std::move(generation), options.history_size, report);
+    history.reset();
+    run_hooks(config, options, hooks, report);
+
+    if (data) {
+      report.callbacks_computed = data->memo().misses();
+      report.callbacks_memoized = data->memo().hits();
+    }
+    report.includes_parsed = includes.misses();
+    report.includes_shared = includes.hits();
+  } catch (std::exception const& e) {
+    return std::unexpected(e.what());
+  }
+
+  return {std::move(report)};
+}
+
+} // namespace walng
@@ -0,0 +1,125 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <inja/inja.hpp>
+
+import walng.basexx_theme;
+import walng.builtin_templates;
+import walng.config;
+import walng.native_template;
+import walng.render;
+import walng.render_cache;
+import walng.template_vm;
+
+export module walng.apply;
+
+namespace walng {
+
+/// Template of item in fastest available form: native template, built-in render function, bytecode or inja
+export struct compiled_template {
+  std::optional<native_template> native;
+  builtin_template const* builtin = nullptr;
+  std::optional<inja::Template> tmpl;
+  std::optional<template_program> program;
+};
+
+/// Parse template of item, content is template source; parse errors are thrown
+/// Items without template path are parsed from content, their includes are resolved against working directory.
+export [[nodiscard]] auto compile_template(inja::Environment& env, application_template const& item,
+    std::string_view content) -> compiled_template;
+
+/// Append rendered template to output, reused output keeps its capacity
+export auto render_template_into(std::string& output, inja::Environment& env, compiled_template const& compiled,
+    theme_data_provider const& data) -> void;
+
+/// Run hook command through shell command ("{}" is replaced with hook command)
+export auto execute_hook(std::string const& shell_exec_cmd, std::string const& hook_cmd)
+    -> std::expected<void, std::string>;
+
+/// Template rendered by apply()
+export struct apply_template {
+  std::string name;
+  /// Template source
+  std::string source;
+  template_engine engine = template_engine::inja;
+};
+
+/// Output of apply()
+export struct apply_output {
+  std::string name;
+  std::string content;
+  /// Parse or render error, content is empty then
+  std::string error;
+};
+
+/// Render templates with theme in memory, the embeddable counterpart of `walng apply`
+/// Nothing is read or written besides included templates: no targets, history or hooks. Callback results and included
+/// templates are shared between templates of one call.
+export [[nodiscard]] auto apply(std::span<apply_template const> templates, basexx_theme const& theme)
+    -> std::vector<apply_output>;
+
+/// Outcome of config item in apply_config()
+export enum class apply_item_status : std::uint8_t {
+  /// Rendered and written
+  rendered,
+  /// Not affected by theme change, output of previous generation is kept
+  skipped,
+  /// Installed from prerendered set
+  installed,
+  /// Not written, see error
+  failed,
+};
+
+export struct apply_item_result {
+  std::string name;
+  apply_item_status status = apply_item_status::failed;
+  /// Error of failed item or of its hook
+  std::string error;
+};
+
+/// Options of apply_config(), defaults render and write every item
+export struct apply_options {
+  /// Number of generations to keep in history, 0 disables history and skipping of unaffected items
+  std::size_t history_size = 0;
+  /// Render cache, nullptr disables it
+  render_cache const* cache = nullptr;
+  /// Install outputs of valid prerendered set of theme instead of rendering
+  bool prerendered = false;
+  /// Called after every item, before the next one is processed
+  std::function<void(apply_item_result const&)> on_item;
+};
+
+/// Result of apply_config()
+export struct apply_report {
+  std::vector<apply_item_result> items;
+  /// Outputs were installed from prerendered set
+  bool prerendered = false;
+  /// Problems which didn't fail items: history, render cache
+  std::vector<std::string> warnings;
+  /// Template callbacks computed and answered from memo
+  std::size_t callbacks_computed = 0;
+  std::size_t callbacks_memoized = 0;
+  /// Included templates parsed and shared between items
+  std::size_t includes_parsed = 0;
+  std::size_t includes_shared = 0;
+};
+
+/// Render every item of config with theme, write targets atomically and run hooks, this is `walng apply`
+/// With history, items which don't read theme data changed since previous generation (and whose templates are
+/// unchanged) are skipped. Failed items don't stop the rest; error is returned only if apply couldn't run at all.
+export [[nodiscard]] auto apply_config(config const& config, basexx_theme const& theme,
+    apply_options const& options = {}) -> std::expected<apply_report, std::string>;
+
+} // namespace walng
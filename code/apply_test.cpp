@@ -0,0 +1,89 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <string>
+
+#include <doctest/doctest.h>
+
+import walng.apply;
+import walng.basexx_theme;
+import walng.config;
+import walng.utils;
+
+namespace {
+
+auto make_theme(std::string const& base00) -> walng::basexx_theme {
+  std::string yaml = "system: base16\nname: test\nauthor: test\nvariant: dark\npalette:\n";
+  for (int i = 0; i < 16; ++i) {
+    yaml += std::format("  base0{:X}: \"{}\"\n", i, i == 0 ? base00 : "#101010");
+  }
+  return walng::basexx_theme_parse_from_yaml_content(yaml).value();
+}
+
+} // namespace
+
+TEST_CASE("apply re-renders item when included template changes") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-apply-test-" + walng::make_random_name());
+  std::filesystem::create_directories(root);
+  ::setenv("XDG_CACHE_HOME", (root / "cache").c_str(), 1);
+
+  REQUIRE(walng::write_file(root / "partial.tmpl", "colors"));
+  REQUIRE(walng::write_file(root / "main.tmpl", "{{ palette.base0F }}:{% include \"partial.tmpl\" %}"));
+
+  walng::config config;
+  config.items.push_back({"item", root / "main.tmpl", root / "output", {}, walng::template_engine::inja});
+
+  walng::apply_options options;
+  options.history_size = 4;
+
+  auto const first = walng::apply_config(config, make_theme("#000000"), options);
+  REQUIRE(first);
+  REQUIRE(first->items.size() == 1);
+  CHECK(first->items[0].status == walng::apply_item_status::rendered);
+  CHECK(walng::read_file(root / "output").value() == "#101010:colors");
+
+  // only base00 changes, item doesn't read it
+  auto const second = walng::apply_config(config, make_theme("#202020"), options);
+  REQUIRE(second);
+  CHECK(second->items[0].status == walng::apply_item_status::skipped);
+
+  REQUIRE(walng::write_file(root / "partial.tmpl", "palette"));
+  auto const third = walng::apply_config(config, make_theme("#303030"), options);
+  REQUIRE(third);
+  CHECK(third->items[0].status == walng::apply_item_status::rendered);
+  CHECK(walng::read_file(root / "output").value() == "#101010:palette");
+
+  ::unsetenv("XDG_CACHE_HOME");
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("apply runs hooks after history is saved and unlocked") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-apply-test-" + walng::make_random_name());
+  std::filesystem::create_directories(root);
+  ::setenv("XDG_CACHE_HOME", (root / "cache").c_str(), 1);
+
+  REQUIRE(walng::write_file(root / "main.tmpl", "{{ palette.base00 }}"));
+
+  // marker is created only when history lock can be taken without waiting
+  auto const history_path = root / "cache" / "walng" / "history";
+  walng::config config;
+  config.shell_exec_cmd = "/bin/sh -c '{}'";
+  config.items.push_back({"item", root / "main.tmpl", root / "output",
+      std::format("flock -n {} touch {}", history_path.c_str(), (root / "marker").c_str()),
+      walng::template_engine::inja});
+
+  walng::apply_options options;
+  options.history_size = 4;
+
+  auto const report = walng::apply_config(config, make_theme("#000000"), options);
+  REQUIRE(report);
+  REQUIRE(report->items.size() == 1);
+  CHECK(report->items[0].error.empty());
+  CHECK(std::filesystem::exists(root / "marker"));
+
+  ::unsetenv("XDG_CACHE_HOME");
+  std::filesystem::remove_all(root);
+}
@@ -4,15 +4,22 @@
 module;
 
 #include <array>
+#include <cstdint>
 #include <expected>
 #include <filesystem>
 #include <format>
 #include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
 
 #include <yaml-cpp/yaml.h>
 
+import walng.binary_io;
 import walng.color;
+import walng.hash;
 import walng.utils;
+import walng.version;
 
 module walng.basexx_theme;
 
@@ -26,8 +33,14 @@ constexpr std::array base24_colors{"base00", "base01", "base02", "base03", "base
     "base08", "base09", "base0A", "base0B", "base0C", "base0D", "base0E", "base0F", "base10", "base11", "base12",
     "base13", "base14", "base15", "base16", "base17"};
 
+constexpr std::uint64_t theme_snapshot_magic = 0x314d4854474e4c57ull; // "WLNGTHM1"
+
 } // namespace
 
+auto basexx_theme_color_name(std::size_t index) noexcept -> std::string_view {
+  return index < base24_colors.size() ? base24_colors[index] : std::string_view();
+}
+
 auto basexx_theme_parse_from_yaml(YAML::Node const& yaml) -> std::expected<basexx_theme, std::string> {
   basexx_theme result;
 
@@ -63,6 +76,49 @@ auto basexx_theme_parse_from_yaml(YAML::Node const& yaml) -> std::expected<basex
   return {std::move(result)};
 }
 
+auto basexx_theme_to_yaml(basexx_theme const& theme) -> std::string {
+  YAML::Emitter out;
+  out << YAML::BeginMap;
+  out << YAML::Key << "system" << YAML::Value << YAML::DoubleQuoted << theme.system;
+  out << YAML::Key << "name" << YAML::Value << YAML::DoubleQuoted << theme.name;
+  out << YAML::Key << "author" << YAML::Value << YAML::DoubleQuoted << theme.author;
+  out << YAML::Key << "variant" << YAML::Value << YAML::DoubleQuoted << theme.variant;
+  out << YAML::Key << "palette" << YAML::Value << YAML::BeginMap;
+  for (std::size_t index = 0; index < theme.palette.size() && index < base24_colors.size(); ++index) {
+    out << YAML::Key << base24_colors[index] << YAML::Value << YAML::DoubleQuoted
+        << std::format("#{}", theme.palette[index].as_hex_str().string());
+  }
+  out << YAML::EndMap;
+  out << YAML::EndMap;
+  return std::string(out.c_str(), out.size()) + "\n";
+}
+
+auto basexx_theme_write(binary_writer& writer, basexx_theme const& theme) -> void {
+  writer.write_string(theme.name);
+  writer.write_string(theme.author);
+  writer.write_string(theme.variant);
+  writer.write_string(theme.system);
+  writer.write(static_cast<std::uint32_t>(theme.palette.size()));
+  for (auto const& color : theme.palette) {
+    writer.write(color.value);
+  }
+}
+
+auto basexx_theme_read(binary_reader& reader, basexx_theme& theme) -> bool {
+  std::uint32_t palette_size;
+  if (!reader.read_string(theme.name) || !reader.read_string(theme.author) || !reader.read_string(theme.variant) ||
+      !reader.read_string(theme.system) || !reader.read(palette_size)) {
+    return false;
+  }
+  theme.palette.resize(palette_size);
+  for (auto& color : theme.palette) {
+    if (!reader.read(color.value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 auto basexx_theme_parse_from_yaml_content(std::string const& content) -> std::expected<basexx_theme, std::string> {
   try {
     return basexx_theme_parse_from_yaml(YAML::Load(content));
@@ -81,4 +137,50 @@ auto basexx_theme_parse_from_yaml_file(std::filesystem::path const& path) -> std
   }
 }
 
+auto basexx_theme_parse_from_yaml_file_cached(std::filesystem::path const& path)
+    -> std::expected<basexx_theme, std::string> {
+  std::filesystem::path expanded_path = path;
+  expand_tilda(expanded_path);
+
+  // snapshot is valid while file path, size and mtime are the same
+  std::error_code ec;
+  auto const canonical_path = std::filesystem::canonical(expanded_path, ec);
+  auto const size = ec ? 0 : std::filesystem::file_size(canonical_path, ec);
+  auto const mtime = ec ? std::filesystem::file_time_type() : std::filesystem::last_write_time(canonical_path, ec);
+  auto const cache_path = get_cache_path();
+  if (ec || !cache_path) {
+    return basexx_theme_parse_from_yaml_file(expanded_path);
+  }
+  auto const fingerprint = hasher()
+                               .update(version)
+                               .update(canonical_path.native())
+                               .update(size)
+                               .update(mtime.time_since_epoch().count())
+                               .digest();
+  auto const snapshot_path =
+      *cache_path / "themes" / std::format("{}.bin", hash_to_hex_str(hash_string(canonical_path.native())).string());
+
+  if (auto const content = read_file(snapshot_path); content) {
+    binary_reader reader(*content);
+    std::uint64_t magic;
+    std::uint64_t stored_fingerprint;
+    basexx_theme result;
+    if (reader.read(magic) && magic == theme_snapshot_magic && reader.read(stored_fingerprint) &&
+        stored_fingerprint == fingerprint && basexx_theme_read(reader, result) && reader.empty()) {
+      return {std::move(result)};
+    }
+  }
+
+  auto result = basexx_theme_parse_from_yaml_file(canonical_path);
+  if (result) {
+    binary_writer writer;
+    writer.write(theme_snapshot_magic);
+    writer.write(fingerprint);
+    basexx_theme_write(writer, *result);
+    // failure to write snapshot only makes next load slower
+    static_cast<void>(write_file(snapshot_path, writer.data()));
+  }
+  return result;
+}
+
 } // namespace walng
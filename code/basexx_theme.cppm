@@ -6,8 +6,10 @@ module;
 #include <expected>
 #include <filesystem>
 #include <string>
+#include <string_view>
 #include <vector>
 
+import walng.binary_io;
 import walng.color;
 
 export module walng.basexx_theme;
@@ -27,6 +29,12 @@ export struct basexx_theme {
   std::vector<color> palette;
 };
 
+/// palette color name by index (base00..base17)
+export [[nodiscard]] auto basexx_theme_color_name(std::size_t index) noexcept -> std::string_view;
+
+/// serialize theme to yaml in base16/base24 scheme format
+export [[nodiscard]] auto basexx_theme_to_yaml(basexx_theme const& theme) -> std::string;
+
 /// parse theme from yaml content
 export [[nodiscard]] auto basexx_theme_parse_from_yaml_content(std::string const& content)
     -> std::expected<basexx_theme, std::string>;
@@ -35,4 +43,15 @@ export [[nodiscard]] auto basexx_theme_parse_from_yaml_content(std::string const
 export [[nodiscard]] auto basexx_theme_parse_from_yaml_file(std::filesystem::path const& path)
     -> std::expected<basexx_theme, std::string>;
 
+/// parse theme from file with yaml content through binary snapshot in cache directory
+/// yaml is parsed only when file changed since snapshot was written
+export [[nodiscard]] auto basexx_theme_parse_from_yaml_file_cached(std::filesystem::path const& path)
+    -> std::expected<basexx_theme, std::string>;
+
+/// write theme in binary snapshot format
+export auto basexx_theme_write(binary_writer& writer, basexx_theme const& theme) -> void;
+
+/// read theme written by basexx_theme_write
+export [[nodiscard]] auto basexx_theme_read(binary_reader& reader, basexx_theme& theme) -> bool;
+
 } // namespace walng
@@ -0,0 +1,88 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+export module walng.binary_io;
+
+namespace walng {
+
+/// Append-only writer for compact binary snapshots
+export class binary_writer {
+private:
+  std::string buffer_;
+
+public:
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  auto write(T const& value) -> binary_writer& {
+    buffer_.append(reinterpret_cast<char const*>(&value), sizeof(T));
+    return *this;
+  }
+
+  auto write_string(std::string_view str) -> binary_writer& {
+    write(static_cast<std::uint32_t>(str.size()));
+    buffer_.append(str);
+    return *this;
+  }
+
+  auto data() const noexcept -> std::string const& {
+    return buffer_;
+  }
+
+  auto release() noexcept -> std::string {
+    return std::move(buffer_);
+  }
+};
+
+/// Reader for data produced by binary_writer; all reads are bounds checked
+export class binary_reader {
+private:
+  std::string_view data_;
+
+public:
+  explicit binary_reader(std::string_view data) noexcept : data_(data) {}
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  [[nodiscard]] auto read(T& value) noexcept -> bool {
+    if (data_.size() < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data_.data(), sizeof(T));
+    data_.remove_prefix(sizeof(T));
+    return true;
+  }
+
+  [[nodiscard]] auto read_string(std::string_view& value) noexcept -> bool {
+    std::uint32_t size;
+    if (!read(size) || data_.size() < size) {
+      return false;
+    }
+    value = data_.substr(0, size);
+    data_.remove_prefix(size);
+    return true;
+  }
+
+  [[nodiscard]] auto read_string(std::string& value) -> bool {
+    std::string_view view;
+    if (!read_string(view)) {
+      return false;
+    }
+    value.assign(view);
+    return true;
+  }
+
+  auto empty() const noexcept -> bool {
+    return data_.empty();
+  }
+};
+
+} // namespace walng
@@ -0,0 +1,108 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <inja/inja.hpp>
+
+import walng.render;
+import walng.utils;
+
+export module walng.builtin_templates;
+
+namespace walng {
+
+/// Template shipped with walng, compiled to C++ at build time (see tools/template_compiler.cpp)
+export struct builtin_template {
+  /// File name in templates/ directory, referenced from config as "builtin:<name>"
+  std::string_view name;
+  /// Template source, used for hashing and analysis
+  std::string_view source;
+  /// Render template, same output as inja rendering of source
+  auto (*render)(theme_data_provider const& data, std::string& output) -> void;
+};
+
+export constexpr std::string_view builtin_template_scheme = "builtin:";
+
+/// Templates from templates/ directory, generated at build time
+export [[nodiscard]] auto get_builtin_templates() -> std::span<builtin_template const>;
+
+/// Builtin template of "builtin:<name>" path, nullptr for other paths or unknown names
+export [[nodiscard]] auto find_builtin_template(std::filesystem::path const& path) -> builtin_template const* {
+  std::string_view const str = path.native();
+  if (!str.starts_with(builtin_template_scheme)) {
+    return nullptr;
+  }
+  auto const name = str.substr(builtin_template_scheme.size());
+  auto const templates = get_builtin_templates();
+  auto const found = std::ranges::find(templates, name, &builtin_template::name);
+  return found != templates.end() ? &*found : nullptr;
+}
+
+/// Read template source, builtin templates are served from binary
+export [[nodiscard]] auto read_template(std::filesystem::path const& path) -> std::expected<std::string, std::string> {
+  if (path.native().starts_with(builtin_template_scheme)) {
+    if (auto const builtin = find_builtin_template(path); builtin) {
+      return std::string(builtin->source);
+    }
+    return std::unexpected(std::format("unknown builtin template '{}'", path.c_str()));
+  }
+  return read_file(path);
+}
+
+/// Parse template, builtin templates are parsed from embedded source
+export [[nodiscard]] auto parse_template(inja::Environment& env, std::filesystem::path const& path) -> inja::Template {
+  if (path.native().starts_with(builtin_template_scheme)) {
+    auto const builtin = find_builtin_template(path);
+    if (!builtin) {
+      throw std::runtime_error(std::format("unknown builtin template '{}'", path.c_str()));
+    }
+    return env.parse(builtin->source);
+  }
+  return env.parse_template(path.string());
+}
+
+namespace detail {
+
+// Runtime of generated render functions
+
+/// Template callback by name, throws if walng has no such callback
+inline auto get_builtin_callback(std::string_view name, int argc) -> template_callback const& {
+  for (auto const& callback : get_template_callbacks()) {
+    if (callback.name == name && callback.argc == argc) {
+      return callback;
+    }
+  }
+  throw std::runtime_error(std::format("unknown template callback '{}'", name));
+}
+
+/// Call callback through memo of theme
+template <typename... Args>
+inline auto call_builtin_callback(theme_data_provider const& data, template_callback const& callback,
+    Args const&... args) -> inja::json const& {
+  inja::Arguments arguments = {&args...};
+  return data.memo().call(callback, arguments);
+}
+
+/// Palette slot value, throws for slots missing in theme like inja does for missing data
+inline auto get_builtin_slot(theme_data_provider const& data, std::size_t index) -> inja::json const& {
+  if (index >= data.palette_size()) {
+    throw std::runtime_error(
+        std::format("variable 'palette.{}' not found", get_palette_slot_name(index).get_ref<std::string const&>()));
+  }
+  return *data.slot(index);
+}
+
+} // namespace detail
+
+} // namespace walng
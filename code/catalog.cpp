@@ -0,0 +1,332 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+import walng.basexx_theme;
+import walng.binary_io;
+import walng.color;
+import walng.hash;
+import walng.utils;
+import walng.version;
+
+module walng.catalog;
+
+namespace walng {
+namespace {
+
+constexpr std::uint64_t catalog_cache_magic = 0x31544143474e4c57ull; // "WLNGCAT1"
+
+/// Lowercase, everything except letters and digits becomes a space
+auto normalize(std::string_view str) -> std::string {
+  std::string result(str);
+  for (auto& ch : result) {
+    if (ch >= 'A' && ch <= 'Z') {
+      ch = static_cast<char>(ch - 'A' + 'a');
+    } else if (!((ch >= 'a' && ch <= 'z') || (ch >= '0' && ch <= '9'))) {
+      ch = ' ';
+    }
+  }
+  return result;
+}
+
+/// Distinct trigrams of key padded with spaces, so word boundaries produce their own trigrams
+auto make_trigrams(std::string_view key) -> std::vector<std::uint32_t> {
+  std::string padded;
+  padded.reserve(key.size() + 2);
+  padded.append(1, ' ').append(key).append(1, ' ');
+
+  std::vector<std::uint32_t> result;
+  if (padded.size() < 3) {
+    return result;
+  }
+  result.reserve(padded.size() - 2);
+  for (std::size_t i = 0; i + 3 <= padded.size(); ++i) {
+    result.push_back((static_cast<std::uint32_t>(static_cast<std::uint8_t>(padded[i])) << 16) |
+                     (static_cast<std::uint32_t>(static_cast<std::uint8_t>(padded[i + 1])) << 8) |
+                     static_cast<std::uint32_t>(static_cast<std::uint8_t>(padded[i + 2])));
+  }
+  std::ranges::sort(result);
+  auto const [first, last] = std::ranges::unique(result);
+  result.erase(first, last);
+  return result;
+}
+
+/// Extra score for direct (non-fuzzy) matches
+auto match_bonus(std::string_view key, std::string_view query) noexcept -> float {
+  if (key == query) {
+    return 3.0f;
+  }
+  if (key.starts_with(query)) {
+    return 2.0f;
+  }
+  auto const found = key.find(query);
+  if (found == key.npos) {
+    return 0.0f;
+  }
+  return key[found - 1] == ' ' ? 1.0f : 0.5f;
+}
+
+struct theme_file {
+  std::filesystem::path path;
+  std::uintmax_t size;
+  std::int64_t mtime;
+};
+
+auto get_catalog_cache_file_path(std::filesystem::path const& catalog_path)
+    -> std::expected<std::filesystem::path, std::string> {
+  return get_cache_path().transform([&](std::filesystem::path const& path) {
+    return path / "catalog" / std::format("{}.bin", hash_to_hex_str(hash_string(catalog_path.native())).string());
+  });
+}
+
+auto read_catalog_cache(std::filesystem::path const& path, std::uint64_t fingerprint)
+    -> std::expected<std::vector<catalog_entry>, std::string> {
+  auto const content = read_file(path);
+  if (!content) {
+    return std::unexpected(content.error());
+  }
+
+  binary_reader reader(*content);
+
+  std::uint64_t magic;
+  std::uint64_t stored_fingerprint;
+  std::uint32_t count;
+  if (!reader.read(magic) || magic != catalog_cache_magic) {
+    return std::unexpected("invalid catalog cache");
+  }
+  if (!reader.read(stored_fingerprint) || stored_fingerprint != fingerprint) {
+    return std::unexpected("catalog cache is outdated");
+  }
+  if (!reader.read(count)) {
+    return std::unexpected("invalid catalog cache");
+  }
+
+  std::vector<catalog_entry> result;
+  result.reserve(count);
+  for (std::uint32_t i = 0; i < count; ++i) {
+    auto& entry = result.emplace_back();
+    std::string_view path_str;
+    if (!reader.read_string(entry.slug) || !reader.read_string(path_str) || !basexx_theme_read(reader, entry.theme)) {
+      return std::unexpected("invalid catalog cache");
+    }
+    entry.path = path_str;
+  }
+
+  return {std::move(result)};
+}
+
+auto write_catalog_cache(std::filesystem::path const& path, std::uint64_t fingerprint,
+    std::vector<catalog_entry> const& entries) -> std::expected<void, std::string> {
+  binary_writer writer;
+  writer.write(catalog_cache_magic);
+  writer.write(fingerprint);
+  writer.write(static_cast<std::uint32_t>(entries.size()));
+  for (auto const& entry : entries) {
+    writer.write_string(entry.slug);
+    writer.write_string(entry.path.native());
+    basexx_theme_write(writer, entry.theme);
+  }
+  return write_file(path, writer.data());
+}
+
+} // namespace
+
+theme_catalog::theme_catalog(std::vector<catalog_entry> entries) : entries_(std::move(entries)) {
+  keys_.reserve(entries_.size());
+  for (auto const& entry : entries_) {
+    keys_.push_back(normalize(entry.slug));
+  }
+
+  // order entries by key so prefix lookups are binary searches
+  std::vector<std::uint32_t> order(entries_.size());
+  for (std::uint32_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::ranges::sort(order, [&](std::uint32_t lhs, std::uint32_t rhs) {
+    if (keys_[lhs] != keys_[rhs]) {
+      return keys_[lhs] < keys_[rhs];
+    }
+    return entries_[lhs].path < entries_[rhs].path;
+  });
+
+  std::vector<catalog_entry> sorted_entries;
+  std::vector<std::string> sorted_keys;
+  sorted_entries.reserve(entries_.size());
+  sorted_keys.reserve(keys_.size());
+  for (auto const index : order) {
+    sorted_entries.push_back(std::move(entries_[index]));
+    sorted_keys.push_back(std::move(keys_[index]));
+  }
+  entries_ = std::move(sorted_entries);
+  keys_ = std::move(sorted_keys);
+
+  trigram_counts_.reserve(keys_.size());
+  for (std::uint32_t id = 0; id < keys_.size(); ++id) {
+    auto const trigrams = make_trigrams(keys_[id]);
+    trigram_counts_.push_back(static_cast<std::uint16_t>(trigrams.size()));
+    for (auto const trigram : trigrams) {
+      trigram_index_[trigram].push_back(id);
+    }
+  }
+}
+
+auto theme_catalog::find(std::string_view slug) const -> catalog_entry const* {
+  auto const key = normalize(slug);
+  auto const found = std::ranges::lower_bound(keys_, key);
+  if (found == keys_.end() || *found != key) {
+    return nullptr;
+  }
+  return &entries_[static_cast<std::size_t>(found - keys_.begin())];
+}
+
+auto theme_catalog::search(std::string_view query, std::size_t limit) const -> std::vector<catalog_match> {
+  std::vector<catalog_match> result;
+
+  auto const key = normalize(query);
+  if (key.find_first_not_of(' ') == key.npos) {
+    // empty query matches everything in alphabetical order
+    auto const count = std::min(limit, entries_.size());
+    result.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      result.push_back(catalog_match{i, 0.0f});
+    }
+    return result;
+  }
+
+  if (key.size() < 3) {
+    // too short for trigrams: prefix range plus substring scan
+    for (std::size_t i = 0; i < keys_.size(); ++i) {
+      if (auto const bonus = match_bonus(keys_[i], key); bonus > 0.0f) {
+        result.push_back(catalog_match{i, bonus});
+      }
+    }
+  } else {
+    auto const query_trigrams = make_trigrams(key);
+
+    std::vector<std::uint16_t> hits(entries_.size(), 0);
+    std::vector<std::uint32_t> touched;
+    for (auto const trigram : query_trigrams) {
+      auto const found = trigram_index_.find(trigram);
+      if (found == trigram_index_.end()) {
+        continue;
+      }
+      for (auto const id : found->second) {
+        if (hits[id]++ == 0) {
+          touched.push_back(id);
+        }
+      }
+    }
+
+    auto const query_count = static_cast<float>(query_trigrams.size());
+    for (auto const id : touched) {
+      auto const common = static_cast<float>(hits[id]);
+      auto const similarity = common / (query_count + static_cast<float>(trigram_counts_[id]) - common);
+      auto const bonus = match_bonus(keys_[id], key);
+      if (similarity >= 0.2f || bonus > 0.0f) {
+        result.push_back(catalog_match{id, similarity + bonus});
+      }
+    }
+  }
+
+  auto const ordering = [&](catalog_match const& lhs, catalog_match const& rhs) {
+    if (lhs.score != rhs.score) {
+      return lhs.score > rhs.score;
+    }
+    if (keys_[lhs.index].size() != keys_[rhs.index].size()) {
+      return keys_[lhs.index].size() < keys_[rhs.index].size();
+    }
+    return lhs.index < rhs.index;
+  };
+
+  if (result.size() > limit) {
+    std::ranges::partial_sort(result, result.begin() + static_cast<std::ptrdiff_t>(limit), ordering);
+    result.resize(limit);
+  } else {
+    std::ranges::sort(result, ordering);
+  }
+
+  return result;
+}
+
+auto get_default_catalog_path() -> std::expected<std::filesystem::path, std::string> {
+  return get_config_path().transform([](std::filesystem::path const& path) {
+    return path / "themes";
+  });
+}
+
+auto load_theme_catalog(std::filesystem::path const& path) -> std::expected<theme_catalog, std::string> {
+  auto catalog_path = path;
+  if (auto const rc = expand_tilda(catalog_path); !rc) {
+    return std::unexpected(rc.error());
+  }
+
+  std::error_code ec;
+  if (!std::filesystem::is_directory(catalog_path, ec)) {
+    return std::unexpected(std::format("catalog directory '{}' not found", catalog_path.native()));
+  }
+
+  std::vector<theme_file> files;
+  auto it = std::filesystem::recursive_directory_iterator(
+      catalog_path, std::filesystem::directory_options::skip_permission_denied, ec);
+  for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+    std::error_code entry_ec;
+    if (!it->is_regular_file(entry_ec)) {
+      continue;
+    }
+    if (auto const extension = it->path().extension(); extension != ".yaml" && extension != ".yml") {
+      continue;
+    }
+    auto const size = it->file_size(entry_ec);
+    auto const mtime = it->last_write_time(entry_ec);
+    if (entry_ec) {
+      continue;
+    }
+    files.push_back(theme_file{it->path(), size, static_cast<std::int64_t>(mtime.time_since_epoch().count())});
+  }
+  if (ec) {
+    return std::unexpected(std::format("can't scan catalog directory '{}' ({})", catalog_path.native(), ec.message()));
+  }
+  std::ranges::sort(files, {}, &theme_file::path);
+
+  hasher fingerprint;
+  fingerprint.update(version).update(catalog_path.native());
+  for (auto const& file : files) {
+    fingerprint.update(file.path.native()).update(file.size).update(file.mtime);
+  }
+
+  auto const cache_file_path = get_catalog_cache_file_path(catalog_path);
+  if (cache_file_path) {
+    if (auto cached = read_catalog_cache(*cache_file_path, fingerprint.digest()); cached) {
+      return theme_catalog(std::move(*cached));
+    }
+  }
+
+  // invalid yaml files are not themes, skip them
+  std::vector<catalog_entry> entries;
+  entries.reserve(files.size());
+  for (auto const& file : files) {
+    if (auto theme = basexx_theme_parse_from_yaml_file(file.path); theme) {
+      entries.push_back(catalog_entry{file.path.stem().string(), file.path, std::move(*theme)});
+    }
+  }
+
+  if (cache_file_path) {
+    // failure to write cache only makes next load slower
+    static_cast<void>(write_catalog_cache(*cache_file_path, fingerprint.digest(), entries));
+  }
+
+  return theme_catalog(std::move(entries));
+}
+
+} // namespace walng
@@ -0,0 +1,88 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+import walng.basexx_theme;
+
+export module walng.catalog;
+
+namespace walng {
+
+/// Theme catalog entry
+export struct catalog_entry {
+  /// Catalog name (theme file name without extension)
+  std::string slug;
+  /// Path to theme file
+  std::filesystem::path path;
+  /// Parsed theme
+  basexx_theme theme;
+};
+
+/// Catalog search result
+export struct catalog_match {
+  /// Index of entry in catalog
+  std::size_t index;
+  /// Match score, higher is better
+  float score;
+};
+
+/// Local theme catalog (directory with base16/base24 yaml schemes)
+export class theme_catalog {
+private:
+  std::vector<catalog_entry> entries_;
+  /// Normalized search keys (lowercase slugs)
+  std::vector<std::string> keys_;
+  /// Number of distinct trigrams per key
+  std::vector<std::uint16_t> trigram_counts_;
+  /// Trigram to ids of entries which contain it
+  std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> trigram_index_;
+
+public:
+  theme_catalog() = default;
+
+  /// Entries are reordered by slug
+  explicit theme_catalog(std::vector<catalog_entry> entries);
+
+  auto entries() const noexcept -> std::span<catalog_entry const> {
+    return entries_;
+  }
+
+  auto size() const noexcept -> std::size_t {
+    return entries_.size();
+  }
+
+  auto empty() const noexcept -> bool {
+    return entries_.empty();
+  }
+
+  auto operator[](std::size_t index) const noexcept -> catalog_entry const& {
+    return entries_[index];
+  }
+
+  /// Find entry by exact slug (case insensitive)
+  [[nodiscard]] auto find(std::string_view slug) const -> catalog_entry const*;
+
+  /// Fuzzy search over catalog, results ordered by score
+  [[nodiscard]] auto search(std::string_view query, std::size_t limit) const -> std::vector<catalog_match>;
+};
+
+/// Default catalog directory, $XDG_CONFIG_HOME/walng/themes
+export [[nodiscard]] auto get_default_catalog_path() -> std::expected<std::filesystem::path, std::string>;
+
+/// Load catalog from directory
+/// Parsed themes are cached in binary form inside get_cache_path() and reused while theme files are unchanged
+export [[nodiscard]] auto load_theme_catalog(std::filesystem::path const& path)
+    -> std::expected<theme_catalog, std::string>;
+
+} // namespace walng
@@ -0,0 +1,143 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+import walng.basexx_theme;
+import walng.catalog;
+import walng.color;
+import walng.utils;
+
+namespace {
+
+auto make_catalog(std::vector<std::string_view> const& slugs) -> walng::theme_catalog {
+  std::vector<walng::catalog_entry> entries;
+  for (auto const slug : slugs) {
+    auto& entry = entries.emplace_back();
+    entry.slug = slug;
+    entry.path = std::format("/themes/{}.yaml", slug);
+    entry.theme.name = slug;
+  }
+  return walng::theme_catalog(std::move(entries));
+}
+
+auto search_slugs(walng::theme_catalog const& catalog, std::string_view query) -> std::vector<std::string> {
+  std::vector<std::string> result;
+  for (auto const& match : catalog.search(query, 10)) {
+    result.push_back(catalog[match.index].slug);
+  }
+  return result;
+}
+
+auto make_theme_yaml(std::string_view name, std::string_view base00) -> std::string {
+  auto result = std::format("system: base16\nname: {}\nauthor: test\nvariant: dark\npalette:\n", name);
+  for (int i = 0; i < 16; ++i) {
+    result += std::format("  base0{:X}: \"{}\"\n", i, i == 0 ? base00 : "#101010");
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("catalog finds entries by slug ignoring case") {
+  auto const catalog = make_catalog({"gruvbox-dark", "nord", "Solarized-Light"});
+
+  REQUIRE(catalog.find("nord"));
+  CHECK(catalog.find("nord")->slug == "nord");
+  CHECK(catalog.find("GRUVBOX-dark")->slug == "gruvbox-dark");
+  CHECK(catalog.find("solarized light")->slug == "Solarized-Light");
+  CHECK_FALSE(catalog.find("gruvbox"));
+
+  // entries are ordered by slug
+  CHECK(catalog[0].slug == "gruvbox-dark");
+  CHECK(catalog[2].slug == "Solarized-Light");
+}
+
+TEST_CASE("catalog search ranks direct matches above fuzzy ones") {
+  auto const catalog = make_catalog({"tokyo-night", "tokyo-night-storm", "night-owl", "gruvbox-dark",
+      "gruvbox-light", "knight", "onedark"});
+
+  // exact match is first, prefix matches follow
+  auto const exact = search_slugs(catalog, "tokyo-night");
+  REQUIRE(exact.size() >= 2);
+  CHECK(exact[0] == "tokyo-night");
+  CHECK(exact[1] == "tokyo-night-storm");
+
+  // prefix and word start matches score above match inside of word
+  auto const night = search_slugs(catalog, "night");
+  REQUIRE(night.size() == 5);
+  CHECK(night[0] == "night-owl");
+  CHECK(night[3] == "knight");
+  // shares trigrams only
+  CHECK(night[4] == "gruvbox-light");
+
+  // typo is matched by trigrams only
+  auto const typo = search_slugs(catalog, "grubvox dark");
+  REQUIRE_FALSE(typo.empty());
+  CHECK(typo[0] == "gruvbox-dark");
+
+  // short queries are matched by substrings, shorter keys first on equal score
+  CHECK(search_slugs(catalog, "ni") ==
+        std::vector<std::string>{"night-owl", "tokyo-night", "tokyo-night-storm", "knight"});
+
+  // empty query lists catalog in order up to limit
+  auto const all = catalog.search("", 3);
+  REQUIRE(all.size() == 3);
+  CHECK(all[0].index == 0);
+  CHECK(all[2].index == 2);
+
+  CHECK(search_slugs(catalog, "xyzzy").empty());
+}
+
+TEST_CASE("catalog is cached until theme files change") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-catalog-test-" + walng::make_random_name());
+  std::filesystem::create_directories(root / "themes");
+  ::setenv("XDG_CACHE_HOME", (root / "cache").c_str(), 1);
+
+  REQUIRE(walng::write_file(root / "themes" / "first.yaml", make_theme_yaml("First", "#000000")));
+  REQUIRE(walng::write_file(root / "themes" / "second.yml", make_theme_yaml("Second", "#202020")));
+  REQUIRE(walng::write_file(root / "themes" / "broken.yaml", "palette: ["));
+  REQUIRE(walng::write_file(root / "themes" / "notes.txt", "not a theme"));
+
+  auto const loaded = walng::load_theme_catalog(root / "themes");
+  REQUIRE(loaded);
+  REQUIRE(loaded->size() == 2);
+  CHECK(loaded->find("second")->theme.palette[0] == walng::color{0x202020u});
+
+  // cached catalog is used while size and mtime of files are the same
+  auto const path = root / "themes" / "first.yaml";
+  auto const mtime = std::filesystem::last_write_time(path);
+  REQUIRE(walng::write_file(path, make_theme_yaml("Other", "#000000")));
+  std::filesystem::last_write_time(path, mtime);
+
+  auto const cached = walng::load_theme_catalog(root / "themes");
+  REQUIRE(cached);
+  REQUIRE(cached->size() == 2);
+  CHECK(cached->find("first")->theme.name == "First");
+  CHECK(cached->find("first")->path == path);
+  CHECK(cached->find("second")->theme.palette == loaded->find("second")->theme.palette);
+
+  // changed mtime invalidates cache
+  std::filesystem::last_write_time(path, mtime + std::chrono::seconds(1));
+  auto const reloaded = walng::load_theme_catalog(root / "themes");
+  REQUIRE(reloaded);
+  CHECK(reloaded->find("first")->theme.name == "Other");
+
+  // added theme invalidates cache
+  REQUIRE(walng::write_file(root / "themes" / "third.yaml", make_theme_yaml("Third", "#303030")));
+  auto const extended = walng::load_theme_catalog(root / "themes");
+  REQUIRE(extended);
+  CHECK(extended->size() == 3);
+
+  ::unsetenv("XDG_CACHE_HOME");
+  std::filesystem::remove_all(root);
+}
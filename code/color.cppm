@@ -3,8 +3,10 @@
 
 module;
 
+#include <algorithm>
 #include <array>
 #include <charconv>
+#include <cmath>
 #include <cstdint>
 #include <expected>
 #include <string_view>
@@ -39,6 +41,34 @@ export struct color_rgb {
   std::uint8_t b; ///< Blue [0..255]
 };
 
+/// OKLab coordinates, see https://bottosson.github.io/posts/oklab/
+export struct color_oklab {
+  float l; ///< Lightness [0..1]
+  float a; ///< Green-red axis
+  float b; ///< Blue-yellow axis
+};
+
+/// OKLCH coordinates, polar form of OKLab
+export struct color_oklch {
+  float l; ///< Lightness [0..1]
+  float c; ///< Chroma
+  float h; ///< Hue [-pi..pi]
+};
+
+namespace detail {
+
+inline auto srgb_to_linear(std::uint8_t value) noexcept -> float {
+  auto const c = static_cast<float>(value) / 255.0f;
+  return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+inline auto linear_to_srgb(float value) noexcept -> std::uint8_t {
+  auto const c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+  return static_cast<std::uint8_t>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+}
+
+} // namespace detail
+
 export struct color {
   /// 0xRRGGBB
   std::uint32_t value = 0;
@@ -69,6 +99,60 @@ export struct color {
     return result;
   }
 
+  auto as_oklab() const noexcept -> color_oklab {
+    auto const rgb = as_rgb();
+    auto const r = detail::srgb_to_linear(rgb.r);
+    auto const g = detail::srgb_to_linear(rgb.g);
+    auto const b = detail::srgb_to_linear(rgb.b);
+
+    auto const l = std::cbrt(0.4122214708f * r + 0.5363325363f * g + 0.0514459929f * b);
+    auto const m = std::cbrt(0.2119034982f * r + 0.6806995451f * g + 0.1073969566f * b);
+    auto const s = std::cbrt(0.0883024619f * r + 0.2817188376f * g + 0.6299787005f * b);
+
+    // clang-format off
+    return color_oklab{
+      0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+      1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+      0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s
+    };
+    // clang-format on
+  }
+
+  auto as_oklch() const noexcept -> color_oklch {
+    auto const lab = as_oklab();
+    return color_oklch{lab.l, std::hypot(lab.a, lab.b), std::atan2(lab.b, lab.a)};
+  }
+
+  /// WCAG 2 relative luminance [0..1]
+  auto relative_luminance() const noexcept -> float {
+    auto const rgb = as_rgb();
+    return 0.2126f * detail::srgb_to_linear(rgb.r) + 0.7152f * detail::srgb_to_linear(rgb.g) +
+           0.0722f * detail::srgb_to_linear(rgb.b);
+  }
+
+  /// Build color from OKLab coordinates, out of gamut channels are clamped
+  static auto from_oklab(color_oklab const& lab) noexcept -> color {
+    auto const l = lab.l + 0.3963377774f * lab.a + 0.2158037573f * lab.b;
+    auto const m = lab.l - 0.1055613458f * lab.a - 0.0638541728f * lab.b;
+    auto const s = lab.l - 0.0894841775f * lab.a - 1.2914855480f * lab.b;
+
+    auto const l3 = l * l * l;
+    auto const m3 = m * m * m;
+    auto const s3 = s * s * s;
+
+    auto const r = detail::linear_to_srgb(+4.0767416621f * l3 - 3.3077115913f * m3 + 0.2309699292f * s3);
+    auto const g = detail::linear_to_srgb(-1.2684380046f * l3 + 2.6097574011f * m3 - 0.3413193965f * s3);
+    auto const b = detail::linear_to_srgb(-0.0041960863f * l3 - 0.7034186147f * m3 + 1.7076147010f * s3);
+
+    return color{
+        (static_cast<std::uint32_t>(r) << 16) | (static_cast<std::uint32_t>(g) << 8) | static_cast<std::uint32_t>(b)};
+  }
+
+  /// Build color from OKLCH coordinates, out of gamut channels are clamped
+  static auto from_oklch(color_oklch const& lch) noexcept -> color {
+    return from_oklab(color_oklab{lch.l, lch.c * std::cos(lch.h), lch.c * std::sin(lch.h)});
+  }
+
   constexpr auto operator<=>(color const&) const = default;
 };
 
@@ -3,20 +3,73 @@
 
 module;
 
+#include <cstdint>
 #include <expected>
 #include <filesystem>
 #include <format>
 #include <string>
+#include <system_error>
 
 #include <yaml-cpp/yaml.h>
 
+import walng.binary_io;
+import walng.hash;
 import walng.utils;
+import walng.version;
 
 module walng.config;
 
 namespace walng {
+namespace {
+
+constexpr std::uint64_t config_snapshot_magic = 0x31474643474e4c57ull; // "WLNGCFG1"
+
+auto write_config(binary_writer& writer, config const& value) -> void {
+  writer.write_string(value.shell_exec_cmd);
+  writer.write(static_cast<std::uint32_t>(value.items.size()));
+  for (auto const& item : value.items) {
+    writer.write_string(item.name);
+    writer.write_string(item.template_path.native());
+    writer.write_string(item.target_path.native());
+    writer.write_string(item.hook_cmd);
+    writer.write(item.engine);
+  }
+}
+
+auto read_config(binary_reader& reader, config& value) -> bool {
+  std::uint32_t items_count;
+  if (!reader.read_string(value.shell_exec_cmd) || !reader.read(items_count)) {
+    return false;
+  }
+  value.items.clear();
+  value.items.reserve(items_count);
+  for (std::uint32_t i = 0; i < items_count; ++i) {
+    auto& item = value.items.emplace_back();
+    std::string template_path;
+    std::string target_path;
+    if (!reader.read_string(item.name) || !reader.read_string(template_path) || !reader.read_string(target_path) ||
+        !reader.read_string(item.hook_cmd) || !reader.read(item.engine)) {
+      return false;
+    }
+    if (item.engine != template_engine::inja && item.engine != template_engine::native) {
+      return false;
+    }
+    item.template_path = std::move(template_path);
+    item.target_path = std::move(target_path);
+  }
+  return true;
+}
+
+auto load_config_from_yaml_file_impl(std::filesystem::path const& path, std::filesystem::path const* home_path)
+    -> std::expected<config, std::string> {
+  auto const expand = [home_path](std::filesystem::path& value) -> std::expected<void, std::string> {
+    if (home_path) {
+      expand_tilda(value, *home_path);
+      return {};
+    }
+    return expand_tilda(value);
+  };
 
-auto load_config_from_yaml_file(std::filesystem::path const& path) -> std::expected<config, std::string> {
   try {
     auto const yaml = YAML::LoadFile(path.c_str());
 
@@ -38,17 +91,124 @@ auto load_config_from_yaml_file(std::filesystem::path const& path) -> std::expec
       template_item.name = yaml_item["name"].as<std::string>();
 
       template_item.template_path = yaml_item["template"].as<std::string>();
-      if (auto const rc = expand_tilda(template_item.template_path); !rc) {
+      if (auto const rc = expand(template_item.template_path); !rc) {
         return std::unexpected(
             std::format("failed to expand tilda in template value of item '{}'", template_item.name));
       }
 
       template_item.target_path = yaml_item["target"].as<std::string>();
-      if (auto const rc = expand_tilda(template_item.target_path); !rc) {
+      if (auto const rc = expand(template_item.target_path); !rc) {
         return std::unexpected(std::format("failed to expand tilda in target value of item '{}'", template_item.name));
       }
 
       template_item.hook_cmd = yaml_item["hook"].as<std::string>("");
+
+      if (auto const engine = yaml_item["engine"].as<std::string>("inja"); engine == "native") {
+        template_item.engine = template_engine::native;
+      } else if (engine != "inja") {
+        return std::unexpected(std::format("unknown engine '{}' of item '{}'", engine, template_item.name));
+      }
+    }
+
+    return {std::move(result)};
+  } catch (YAML::Exception const& e) {
+    return std::unexpected(e.what());
+  }
+}
+
+} // namespace
+
+auto load_config_from_yaml_file(std::filesystem::path const& path) -> std::expected<config, std::string> {
+  return load_config_from_yaml_file_impl(path, nullptr);
+}
+
+auto load_config_from_yaml_file(std::filesystem::path const& path, std::filesystem::path const& home_path)
+    -> std::expected<config, std::string> {
+  return load_config_from_yaml_file_impl(path, &home_path);
+}
+
+auto load_config_from_yaml_file_cached(std::filesystem::path const& path) -> std::expected<config, std::string> {
+  // snapshot is valid while file path, size, mtime and $HOME (paths are stored with "~/" expanded) are the same
+  std::error_code ec;
+  auto const canonical_path = std::filesystem::canonical(path, ec);
+  auto const size = ec ? 0 : std::filesystem::file_size(canonical_path, ec);
+  auto const mtime = ec ? std::filesystem::file_time_type() : std::filesystem::last_write_time(canonical_path, ec);
+  auto const cache_path = get_cache_path();
+  if (ec || !cache_path) {
+    return load_config_from_yaml_file(path);
+  }
+  auto const home_path = get_home_path().value_or(std::filesystem::path());
+  auto const fingerprint = hasher()
+                               .update(version)
+                               .update(canonical_path.native())
+                               .update(size)
+                               .update(mtime.time_since_epoch().count())
+                               .update(home_path.native())
+                               .digest();
+  auto const snapshot_path =
+      *cache_path / "configs" / std::format("{}.bin", hash_to_hex_str(hash_string(canonical_path.native())).string());
+
+  if (auto const content = read_file(snapshot_path); content) {
+    binary_reader reader(*content);
+    std::uint64_t magic;
+    std::uint64_t stored_fingerprint;
+    config result;
+    if (reader.read(magic) && magic == config_snapshot_magic && reader.read(stored_fingerprint) &&
+        stored_fingerprint == fingerprint && read_config(reader, result) && reader.empty()) {
+      return {std::move(result)};
+    }
+  }
+
+  auto result = load_config_from_yaml_file(canonical_path);
+  if (result) {
+    binary_writer writer;
+    writer.write(config_snapshot_magic);
+    writer.write(fingerprint);
+    write_config(writer, *result);
+    // failure to write snapshot only makes next load slower
+    static_cast<void>(write_file(snapshot_path, writer.data()));
+  }
+  return result;
+}
+
+auto load_fleet_manifest_from_yaml_file(std::filesystem::path const& path)
+    -> std::expected<fleet_manifest, std::string> {
+  try {
+    auto const yaml = YAML::LoadFile(path.c_str());
+    auto const base_path = path.parent_path();
+    auto const resolve = [&base_path](std::filesystem::path value) {
+      if (auto const rc = expand_tilda(value); rc && value.is_relative()) {
+        value = base_path / value;
+      }
+      return value.lexically_normal();
+    };
+
+    fleet_manifest result;
+    if (auto const& yaml_templates = yaml["templates"]; yaml_templates) {
+      result.templates_path = resolve(yaml_templates.as<std::string>());
+    }
+
+    auto const& yaml_tenants = yaml["tenants"];
+    auto const tenants_count = yaml_tenants.size();
+    result.tenants.reserve(tenants_count);
+
+    for (std::size_t i = 0; i < tenants_count; ++i) {
+      auto const& yaml_tenant = yaml_tenants[i];
+
+      auto& tenant = result.tenants.emplace_back();
+      tenant.name = yaml_tenant["name"].as<std::string>();
+      tenant.root = resolve(yaml_tenant["root"].as<std::string>());
+      if (auto const& yaml_config = yaml_tenant["config"]; yaml_config) {
+        tenant.config_path = resolve(yaml_config.as<std::string>());
+      } else {
+        tenant.config_path = tenant.root / ".config" / "walng" / "config.yaml";
+      }
+      tenant.theme = yaml_tenant["theme"].as<std::string>();
+      // theme may be a name or url, resolve only existing relative files
+      if (std::filesystem::path theme_path = tenant.theme;
+          theme_path.is_relative() && std::filesystem::exists(base_path / theme_path)) {
+        tenant.theme = (base_path / theme_path).lexically_normal().string();
+      }
     }
 
     return {std::move(result)};
@@ -3,6 +3,7 @@
 
 module;
 
+#include <cstdint>
 #include <expected>
 #include <filesystem>
 #include <string>
@@ -12,6 +13,14 @@ export module walng.config;
 
 namespace walng {
 
+/// Template engine of item
+export enum class template_engine : std::uint8_t {
+  /// Full template language
+  inja,
+  /// Placeholder substitution only (see walng.native_template)
+  native,
+};
+
 /// Application templates configuration
 export struct application_template {
   /// Entry name
@@ -22,6 +31,8 @@ export struct application_template {
   std::filesystem::path target_path;
   /// Hook command
   std::string hook_cmd;
+  /// Engine rendering template
+  template_engine engine = template_engine::inja;
 };
 
 /// Application config
@@ -35,4 +46,36 @@ export struct config {
 export [[nodiscard]] auto load_config_from_yaml_file(std::filesystem::path const& path)
     -> std::expected<config, std::string>;
 
+/// Load config through binary snapshot in cache directory, yaml is parsed only when config file or $HOME changed
+export [[nodiscard]] auto load_config_from_yaml_file_cached(std::filesystem::path const& path)
+    -> std::expected<config, std::string>;
+
+/// Load config with "~/" in template and target paths expanded to home_path instead of $HOME
+export [[nodiscard]] auto load_config_from_yaml_file(std::filesystem::path const& path,
+    std::filesystem::path const& home_path) -> std::expected<config, std::string>;
+
+/// Fleet tenant, one user account
+export struct fleet_tenant {
+  /// Tenant name
+  std::string name;
+  /// Home directory, all targets are written below it
+  std::filesystem::path root;
+  /// Path to tenant config file
+  std::filesystem::path config_path;
+  /// Path, url or catalog name of theme
+  std::string theme;
+};
+
+/// Fleet manifest
+export struct fleet_manifest {
+  /// Shared templates directory, tenant templates are read from tenant root or from it
+  std::filesystem::path templates_path;
+  std::vector<fleet_tenant> tenants;
+};
+
+/// Load fleet manifest, relative paths are resolved against manifest directory
+/// Tenant config defaults to <root>/.config/walng/config.yaml
+export [[nodiscard]] auto load_fleet_manifest_from_yaml_file(std::filesystem::path const& path)
+    -> std::expected<fleet_manifest, std::string>;
+
 } // namespace walng
@@ -3,10 +3,13 @@
 
 module;
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <expected>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 
 #include <curl/curl.h>
@@ -66,12 +69,13 @@ public:
   template <typename T>
   auto get_info(CURLINFO info) const -> std::expected<T, CURLcode> {
     if constexpr (std::is_same_v<T, std::string>) {
+      // missing values (e.g. no Content-Type header) are null
       return this->get_info_impl<char const*>(info).transform([](char const* value) {
-        return std::string(value);
+        return value ? std::string(value) : std::string();
       });
     } else if constexpr (std::is_same_v<T, std::string_view>) {
       return this->get_info_impl<char const*>(info).transform([](char const* value) {
-        return std::string_view(value);
+        return value ? std::string_view(value) : std::string_view();
       });
     } else {
       return this->get_info_impl<T>(info);
@@ -191,11 +195,36 @@ static auto curl_write_fn(char const* data, size_t size, size_t nmemb, void* use
   return chunk_size;
 };
 
+static auto curl_read_fn(char* buffer, size_t size, size_t nitems, void* userdata) -> size_t {
+  auto const content = static_cast<std::string_view*>(userdata);
+  auto const chunk_size = std::min(size * nitems, content->size());
+  std::memcpy(buffer, content->data(), chunk_size);
+  content->remove_prefix(chunk_size);
+  return chunk_size;
+}
+
+static auto curl_discard_fn(char const*, size_t size, size_t nmemb, void*) -> size_t {
+  return size * nmemb;
+}
+
+/// libcurl and its TLS backend are initialized by the first transfer, so runs without network access never pay for it
+/// Implicit initialization of curl_easy_init is not thread-safe and transfers start from parallel_for workers, so the
+/// first transfer initializes libcurl explicitly.
+static auto init_curl() -> bool {
+  // function-local static, initialized exactly once even when called from several threads
+  static auto const rc = ::curl_global_init(CURL_GLOBAL_DEFAULT);
+  return rc == CURLE_OK;
+}
+
 } // namespace
 
 auto download(char const* url, std::optional<std::chrono::milliseconds> timeout)
     -> std::expected<download_response, std::string> {
 
+  if (!init_curl()) {
+    return std::unexpected("can't init curl (global)");
+  }
+
   detail::curl_easy_handle handle;
   if (!handle) {
     return std::unexpected("can't init curl");
@@ -243,4 +272,58 @@ auto download(char const* url, std::optional<std::chrono::milliseconds> timeout)
   return {std::move(response)};
 }
 
+auto upload(char const* url, std::string_view content, std::optional<std::chrono::milliseconds> timeout)
+    -> std::expected<unsigned, std::string> {
+
+  if (!init_curl()) {
+    return std::unexpected("can't init curl (global)");
+  }
+
+  detail::curl_easy_handle handle;
+  if (!handle) {
+    return std::unexpected("can't init curl");
+  }
+
+  if (auto const result = handle.set_option(CURLOPT_UPLOAD, 1L); !result) {
+    return std::unexpected("can't init curl (upload)");
+  }
+  if (auto const result = handle.set_option(CURLOPT_READDATA, &content); !result) {
+    return std::unexpected("can't init curl (read data)");
+  }
+  if (auto const result = handle.set_option(CURLOPT_READFUNCTION, curl_read_fn); !result) {
+    return std::unexpected("can't init curl (read function)");
+  }
+  if (auto const result = handle.set_option(CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(content.size()));
+      !result) {
+    return std::unexpected("can't init curl (file size)");
+  }
+  if (auto const result = handle.set_option(CURLOPT_WRITEFUNCTION, curl_discard_fn); !result) {
+    return std::unexpected("can't init curl (write function)");
+  }
+  if (auto const result = handle.set_option(CURLOPT_URL, url); !result) {
+    return std::unexpected("can't init curl (url)");
+  }
+
+  if (timeout) {
+    if (auto const result = handle.set_option(CURLOPT_TIMEOUT_MS, static_cast<long>(timeout->count())); !result) {
+      return std::unexpected("can't init curl (timeout)");
+    }
+  }
+
+  char error_buffer[CURL_ERROR_SIZE] = {0};
+  if (auto const result = handle.set_option(CURLOPT_ERRORBUFFER, error_buffer); !result) {
+    return std::unexpected("can't init curl (error buffer)");
+  }
+
+  if (auto const result = handle.perform(); !result) {
+    return std::unexpected(std::string(error_buffer));
+  }
+
+  unsigned response_code = 0;
+  if (auto const result = handle.get_info<long>(CURLINFO_RESPONSE_CODE); result) {
+    response_code = static_cast<unsigned>(result.value());
+  }
+  return response_code;
+}
+
 } // namespace walng
@@ -7,6 +7,7 @@ module;
 #include <expected>
 #include <optional>
 #include <string>
+#include <string_view>
 
 export module walng.download;
 
@@ -27,4 +28,13 @@ struct download_response {
   return download(url.c_str(), timeout);
 }
 
+/// Upload content with HTTP PUT, returns response code
+[[nodiscard]] auto upload(char const* url, std::string_view content,
+    std::optional<std::chrono::milliseconds> timeout = std::nullopt) -> std::expected<unsigned, std::string>;
+
+[[nodiscard]] auto upload(std::string const& url, std::string_view content,
+    std::optional<std::chrono::milliseconds> timeout = std::nullopt) -> std::expected<unsigned, std::string> {
+  return upload(url.c_str(), content, timeout);
+}
+
 } // namespace walng
@@ -0,0 +1,105 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+
+export module walng.hash;
+
+namespace walng {
+
+/// 64-bit FNV-1a hasher
+export class hasher {
+private:
+  static constexpr std::uint64_t offset_basis = 0xcbf29ce484222325ull;
+  static constexpr std::uint64_t prime = 0x100000001b3ull;
+
+  std::uint64_t value_ = offset_basis;
+
+public:
+  constexpr auto update(std::string_view data) noexcept -> hasher& {
+    for (auto const ch : data) {
+      value_ ^= static_cast<std::uint8_t>(ch);
+      value_ *= prime;
+    }
+    return *this;
+  }
+
+  template <typename T>
+    requires std::is_integral_v<T> || std::is_enum_v<T>
+  constexpr auto update(T value) noexcept -> hasher& {
+    auto const bits = static_cast<std::uint64_t>(value);
+    for (std::size_t i = 0; i < sizeof(T); ++i) {
+      value_ ^= static_cast<std::uint8_t>(bits >> (i * 8));
+      value_ *= prime;
+    }
+    return *this;
+  }
+
+  constexpr auto digest() const noexcept -> std::uint64_t {
+    return value_;
+  }
+};
+
+/// Hash a string in one go
+export [[nodiscard]] constexpr auto hash_string(std::string_view data) noexcept -> std::uint64_t {
+  return hasher().update(data).digest();
+}
+
+export struct hash_hex_str {
+  char value[17] = {'\0'};
+
+  constexpr operator char const*() const noexcept {
+    return value;
+  }
+
+  constexpr operator std::string_view() const noexcept {
+    return value;
+  }
+
+  constexpr auto c_str() const noexcept -> char const* {
+    return value;
+  }
+
+  constexpr auto string() const noexcept -> std::string_view {
+    return value;
+  }
+};
+
+/// Format hash as 16 lowercase hex digits
+export [[nodiscard]] constexpr auto hash_to_hex_str(std::uint64_t hash) noexcept -> hash_hex_str {
+  constexpr std::array chars = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+
+  hash_hex_str result;
+  for (std::size_t i = 0; i < 16; ++i) {
+    result.value[15 - i] = chars[(hash >> (i * 4)) & 0x0F];
+  }
+  return result;
+}
+
+/// Parse hash from 16 hex digits
+export [[nodiscard]] constexpr auto hash_from_hex_str(std::string_view str) noexcept -> std::optional<std::uint64_t> {
+  if (str.size() != 16) {
+    return std::nullopt;
+  }
+  std::uint64_t result = 0;
+  for (auto const ch : str) {
+    result <<= 4;
+    if (ch >= '0' && ch <= '9') {
+      result |= static_cast<std::uint64_t>(ch - '0');
+    } else if (ch >= 'a' && ch <= 'f') {
+      result |= static_cast<std::uint64_t>(ch - 'a' + 10);
+    } else {
+      return std::nullopt;
+    }
+  }
+  return result;
+}
+
+} // namespace walng
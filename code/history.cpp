@@ -0,0 +1,143 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+import walng.basexx_theme;
+import walng.binary_io;
+import walng.store;
+import walng.utils;
+
+module walng.history;
+
+namespace walng {
+namespace {
+
+constexpr std::uint64_t history_magic = 0x32534948474e4c57ull; // "WLNGHIS2"
+
+} // namespace
+
+history::history(std::filesystem::path root, file_lock lock)
+    : root_(std::move(root)), lock_(std::move(lock)), store_(root_ / "blobs", write_mode::durable) {}
+
+auto history::load(std::filesystem::path const& root) -> std::expected<history, std::string> {
+  std::error_code ec;
+  std::filesystem::create_directories(root, ec);
+  if (ec) {
+    return std::unexpected(ec.message());
+  }
+  auto lock = file_lock::acquire(root);
+  if (!lock) {
+    return std::unexpected(std::format("failed to lock history ({})", lock.error()));
+  }
+  history result(root, std::move(lock.value()));
+
+  auto const content = read_file(root / "generations.bin");
+  if (!content) {
+    // no history yet
+    return {std::move(result)};
+  }
+
+  binary_reader reader(*content);
+
+  std::uint64_t magic;
+  std::uint32_t count;
+  if (!reader.read(magic) || magic != history_magic || !reader.read(count)) {
+    return std::unexpected("invalid history file");
+  }
+
+  result.generations_.resize(count);
+  for (auto& generation : result.generations_) {
+    std::uint32_t entries_count;
+    if (!reader.read(generation.id) || !reader.read(generation.timestamp) ||
+        !basexx_theme_read(reader, generation.theme) || !reader.read(entries_count)) {
+      return std::unexpected("invalid history file");
+    }
+    generation.entries.resize(entries_count);
+    for (auto& entry : generation.entries) {
+      std::string_view target_path;
+      if (!reader.read_string(entry.name) || !reader.read_string(target_path) || !reader.read(entry.template_hash) ||
+          !reader.read(entry.blob_hash) || !reader.read_string(entry.hook_cmd)) {
+        return std::unexpected("invalid history file");
+      }
+      entry.target_path = target_path;
+    }
+  }
+
+  return {std::move(result)};
+}
+
+auto history::push(generation value, std::size_t keep) -> std::expected<void, std::string> {
+  value.id = generations_.empty() ? 1 : generations_.back().id + 1;
+  value.timestamp =
+      std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  generations_.push_back(std::move(value));
+
+  std::vector<generation> dropped;
+  if (generations_.size() > keep) {
+    auto const count = static_cast<std::ptrdiff_t>(generations_.size() - keep);
+    dropped.assign(
+        std::make_move_iterator(generations_.begin()), std::make_move_iterator(generations_.begin() + count));
+    generations_.erase(generations_.begin(), generations_.begin() + count);
+  }
+
+  binary_writer writer;
+  writer.write(history_magic);
+  writer.write(static_cast<std::uint32_t>(generations_.size()));
+  for (auto const& generation : generations_) {
+    writer.write(generation.id);
+    writer.write(generation.timestamp);
+    basexx_theme_write(writer, generation.theme);
+    writer.write(static_cast<std::uint32_t>(generation.entries.size()));
+    for (auto const& entry : generation.entries) {
+      writer.write_string(entry.name);
+      writer.write_string(entry.target_path.native());
+      writer.write(entry.template_hash);
+      writer.write(entry.blob_hash);
+      writer.write_string(entry.hook_cmd);
+    }
+  }
+  if (auto const rc = write_file(root_ / "generations.bin", writer.data(), write_mode::durable); !rc) {
+    return std::unexpected(rc.error());
+  }
+
+  // drop blobs which are not referenced by kept generations
+  std::unordered_set<std::uint64_t> referenced;
+  for (auto const& generation : generations_) {
+    for (auto const& entry : generation.entries) {
+      referenced.insert(entry.blob_hash);
+    }
+  }
+  for (auto const& generation : dropped) {
+    for (auto const& entry : generation.entries) {
+      if (!referenced.contains(entry.blob_hash)) {
+        std::error_code ec;
+        std::filesystem::remove(store_.path(entry.blob_hash), ec);
+      }
+    }
+  }
+
+  return {};
+}
+
+auto get_history_path() -> std::expected<std::filesystem::path, std::string> {
+  return get_cache_path().transform([](std::filesystem::path const& path) {
+    return path / "history";
+  });
+}
+
+} // namespace walng
@@ -0,0 +1,80 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+import walng.basexx_theme;
+import walng.store;
+import walng.utils;
+
+export module walng.history;
+
+namespace walng {
+
+/// Applied config item
+export struct generation_entry {
+  /// Config item name
+  std::string name;
+  /// Written file
+  std::filesystem::path target_path;
+  /// Hash of template and templates it includes (hash_template_tree)
+  std::uint64_t template_hash;
+  /// Hash of written content (blob name)
+  std::uint64_t blob_hash;
+  /// Hook executed after write
+  std::string hook_cmd;
+};
+
+/// Output set of one apply
+export struct generation {
+  /// Sequence number, grows with every apply
+  std::uint64_t id = 0;
+  /// Unix time of apply
+  std::int64_t timestamp = 0;
+  /// Applied theme
+  basexx_theme theme;
+  std::vector<generation_entry> entries;
+};
+
+/// Ring of last applied generations, outputs are kept as deduplicated blobs
+export class history {
+private:
+  std::filesystem::path root_;
+  /// Lock of history directory, held while history is loaded so concurrent applies don't lose generations or
+  /// collect blobs of each other
+  file_lock lock_;
+  blob_store store_;
+  /// Oldest first
+  std::vector<generation> generations_;
+
+  history(std::filesystem::path root, file_lock lock);
+
+public:
+  /// Load history from directory, missing history is empty
+  /// Waits while history is loaded by another process.
+  [[nodiscard]] static auto load(std::filesystem::path const& root) -> std::expected<history, std::string>;
+
+  auto generations() const noexcept -> std::span<generation const> {
+    return generations_;
+  }
+
+  auto store() const noexcept -> blob_store const& {
+    return store_;
+  }
+
+  /// Append generation (id and timestamp are assigned), keep last `keep` generations and drop unreferenced blobs
+  auto push(generation value, std::size_t keep) -> std::expected<void, std::string>;
+};
+
+/// History location, $XDG_CACHE_HOME/walng/history
+export [[nodiscard]] auto get_history_path() -> std::expected<std::filesystem::path, std::string>;
+
+} // namespace walng
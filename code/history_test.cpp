@@ -0,0 +1,80 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <thread>
+
+#include <doctest/doctest.h>
+
+import walng.history;
+import walng.utils;
+
+namespace {
+
+auto make_generation(walng::history const& history, std::string const& content) -> walng::generation {
+  walng::generation result;
+  result.theme.name = content;
+  auto const blob_hash = history.store().put(content);
+  REQUIRE(blob_hash);
+  result.entries.push_back({"item", "/tmp/item", 1, *blob_hash, {}});
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("history keeps last generations and collects dropped blobs") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-history-test-" + walng::make_random_name());
+  std::uint64_t first_blob = 0;
+  std::uint64_t shared_blob = 0;
+  {
+    auto history = walng::history::load(root);
+    REQUIRE(history);
+    CHECK(history->generations().empty());
+
+    auto first = make_generation(*history, "first");
+    first_blob = first.entries[0].blob_hash;
+    REQUIRE(history->push(std::move(first), 2));
+    auto second = make_generation(*history, "shared");
+    shared_blob = second.entries[0].blob_hash;
+    REQUIRE(history->push(std::move(second), 2));
+    REQUIRE(history->push(make_generation(*history, "shared"), 2));
+
+    CHECK(history->generations().size() == 2);
+    CHECK_FALSE(history->store().contains(first_blob));
+    CHECK(history->store().contains(shared_blob));
+  }
+
+  auto const reloaded = walng::history::load(root);
+  REQUIRE(reloaded);
+  REQUIRE(reloaded->generations().size() == 2);
+  CHECK(reloaded->generations()[0].id == 2);
+  CHECK(reloaded->generations()[1].id == 3);
+  CHECK(reloaded->generations()[1].theme.name == "shared");
+  CHECK(reloaded->generations()[1].entries[0].blob_hash == shared_blob);
+
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("history is loaded by one owner at a time") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-history-test-" + walng::make_random_name());
+  std::atomic<bool> loaded = false;
+  std::thread other;
+  {
+    auto history = walng::history::load(root);
+    REQUIRE(history);
+    other = std::thread([&] {
+      auto const result = walng::history::load(root);
+      loaded = static_cast<bool>(result);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK_FALSE(loaded);
+  }
+  other.join();
+  CHECK(loaded);
+
+  std::filesystem::remove_all(root);
+}
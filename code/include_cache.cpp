@@ -0,0 +1,61 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <filesystem>
+#include <functional>
+#include <set>
+#include <string>
+#include <system_error>
+
+#include <inja/inja.hpp>
+
+module walng.include_cache;
+
+namespace walng {
+
+auto include_cache::attach(inja::Environment& env) -> void {
+  env.set_include_loader([this](std::string const& path, std::function<inja::Template()> const& parse) {
+    return load(path, parse);
+  });
+}
+
+auto include_cache::load(std::string const& path, std::function<inja::Template()> const& parse) -> inja::Template {
+  std::error_code ec;
+  auto const canonical_path = std::filesystem::canonical(path, ec);
+  if (ec) {
+    return parse();
+  }
+  auto const mtime = std::filesystem::last_write_time(canonical_path, ec);
+  if (ec) {
+    return parse();
+  }
+
+  auto const key = canonical_path.string();
+  if (auto const found = entries_.find(key); found != entries_.end() && found->second.mtime == mtime) {
+    ++hits_;
+    return found->second.tmpl;
+  }
+
+  // file includes itself (possibly through other files): the outer parse stores the complete template later, the
+  // renderer looks includes up by name only when rendering
+  if (!loading_.insert(key).second) {
+    return inja::Template();
+  }
+  struct loading_guard {
+    std::set<std::string>& loading;
+    std::string const& key;
+
+    ~loading_guard() {
+      loading.erase(key);
+    }
+  } const guard{loading_, key};
+
+  ++misses_;
+  auto tmpl = parse();
+  entries_.insert_or_assign(key, entry{mtime, tmpl});
+  return tmpl;
+}
+
+} // namespace walng
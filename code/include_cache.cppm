@@ -0,0 +1,59 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+#include <inja/inja.hpp>
+
+export module walng.include_cache;
+
+namespace walng {
+
+/// Parsed include / extends templates keyed on canonical path and modification time
+/// A partial included by several templates (through any relative path) is read and parsed once, edited files are
+/// parsed again. Parsed templates are bound to callbacks of the environment which parsed them, so cache is attached
+/// to one environment and must outlive it. Not thread-safe, templates are parsed from one thread.
+export class include_cache {
+private:
+  struct entry {
+    std::filesystem::file_time_type mtime;
+    inja::Template tmpl;
+  };
+
+  std::unordered_map<std::string, entry> entries_;
+  /// Files being parsed, to break include cycles
+  std::set<std::string> loading_;
+  std::size_t hits_ = 0;
+  std::size_t misses_ = 0;
+
+public:
+  include_cache() = default;
+
+  // environment refers to attached cache
+  include_cache(include_cache const&) = delete;
+  include_cache& operator=(include_cache const&) = delete;
+
+  /// Load included files of env through cache
+  auto attach(inja::Environment& env) -> void;
+
+  /// Parsed template of file, parse is called for new and modified files
+  /// Files which can't be stat'ed are parsed every time, so parse reports the error.
+  [[nodiscard]] auto load(std::string const& path, std::function<inja::Template()> const& parse) -> inja::Template;
+
+  auto hits() const noexcept -> std::size_t {
+    return hits_;
+  }
+
+  auto misses() const noexcept -> std::size_t {
+    return misses_;
+  }
+};
+
+} // namespace walng
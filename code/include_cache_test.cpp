@@ -0,0 +1,64 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <chrono>
+#include <filesystem>
+
+#include <doctest/doctest.h>
+#include <inja/inja.hpp>
+
+import walng.include_cache;
+import walng.render;
+import walng.utils;
+
+TEST_CASE("include cache parses shared partial once") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-include-cache-test-" + walng::make_random_name());
+  std::filesystem::create_directories(root / "a");
+  std::filesystem::create_directories(root / "b");
+
+  REQUIRE(walng::write_file(root / "partial.tmpl", "{{ name }}"));
+  REQUIRE(walng::write_file(root / "a" / "main.tmpl", "a:{% include \"../partial.tmpl\" %}"));
+  REQUIRE(walng::write_file(root / "b" / "main.tmpl", "b:{% include \"../b/../partial.tmpl\" %}"));
+
+  walng::include_cache includes;
+  auto env = walng::get_inja_env();
+  includes.attach(env);
+
+  inja::json const data = {{"name", "test"}};
+  auto const a = env.parse_template((root / "a" / "main.tmpl").string());
+  auto const b = env.parse_template((root / "b" / "main.tmpl").string());
+  CHECK(env.render(a, data) == "a:test");
+  CHECK(env.render(b, data) == "b:test");
+  CHECK(includes.misses() == 1);
+  CHECK(includes.hits() == 1);
+
+  // edited partial is parsed again
+  auto const path = root / "partial.tmpl";
+  REQUIRE(walng::write_file(path, "{{ name }}!"));
+  std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(1));
+  auto const edited = env.parse_template((root / "a" / "main.tmpl").string());
+  CHECK(env.render(edited, data) == "a:test!");
+  CHECK(includes.misses() == 2);
+
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("include cache breaks include cycles") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-include-cache-test-" + walng::make_random_name());
+  std::filesystem::create_directories(root);
+
+  REQUIRE(walng::write_file(root / "a.tmpl", "A{% if false %}{% include \"b.tmpl\" %}{% endif %}"));
+  REQUIRE(walng::write_file(root / "b.tmpl", "B{% include \"a.tmpl\" %}"));
+  REQUIRE(walng::write_file(root / "self.tmpl", "S{% if false %}{% include \"self.tmpl\" %}{% endif %}"));
+
+  walng::include_cache includes;
+  auto env = walng::get_inja_env();
+  includes.attach(env);
+
+  auto const b = env.parse_template((root / "b.tmpl").string());
+  CHECK(env.render(b, inja::json::object()) == "BA");
+  auto const self = env.parse_template((root / "self.tmpl").string());
+  CHECK(env.render(self, inja::json::object()) == "S");
+
+  std::filesystem::remove_all(root);
+}
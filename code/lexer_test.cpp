@@ -0,0 +1,87 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <cstddef>
+#include <exception>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <inja/inja.hpp>
+
+namespace {
+
+/// Tokens of template as (kind, text) pairs, last element is error message if lexer threw
+auto lex(inja::LexerConfig const& config, std::string_view source) -> std::vector<std::pair<int, std::string>> {
+  std::vector<std::pair<int, std::string>> result;
+  inja::Lexer lexer(config);
+  try {
+    lexer.start(source);
+    for (std::size_t i = 0; i <= source.size() + 1; ++i) {
+      auto const token = lexer.scan();
+      result.emplace_back(static_cast<int>(token.kind), std::string(token.text));
+      if (token.kind == inja::Token::Kind::Eof) {
+        break;
+      }
+    }
+  } catch (std::exception const& e) {
+    result.emplace_back(-1, e.what());
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("pair scan finds first open sequence") {
+  std::string_view const pairs = "{{{%{#";
+  std::mt19937 rng(41);
+  std::string_view const alphabet = "{#%}a\n";
+  std::uniform_int_distribution<std::size_t> pick(0, alphabet.size() - 1);
+  std::uniform_int_distribution<std::size_t> length(0, 100);
+
+  for (int round = 0; round < 20000; ++round) {
+    std::string text(length(rng), ' ');
+    for (auto& ch : text) {
+      ch = alphabet[pick(rng)];
+    }
+
+    auto expected = std::string_view::npos;
+    for (std::size_t i = 0; i + 1 < text.size() && expected == std::string_view::npos; ++i) {
+      for (std::size_t p = 0; p < pairs.size(); p += 2) {
+        if (text[i] == pairs[p] && text[i + 1] == pairs[p + 1]) {
+          expected = i;
+        }
+      }
+    }
+    REQUIRE(inja::find_first_pair(text, pairs) == expected);
+  }
+}
+
+TEST_CASE("lexer gives the same tokens with pair and single character scan") {
+  std::vector<std::string_view> const fragments = {"{", "}", "#", "%", "-", "{{", "}}", "{%", "%}", "{#", "#}", "{%-",
+      "-%}", "{{-", "-}}", "{%+", "\n", "  ", "## ", "a", "#fff", "name", ".", "\"", "color: #102030;", "{ }"};
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<std::size_t> pick(0, fragments.size() - 1);
+  std::uniform_int_distribution<std::size_t> length(0, 40);
+
+  for (bool const trim : {false, true}) {
+    inja::LexerConfig config;
+    config.trim_blocks = trim;
+    config.lstrip_blocks = trim;
+    config.update_open_chars();
+    REQUIRE_FALSE(config.open_pairs.empty());
+    auto reference = config;
+    reference.open_pairs.clear();
+
+    for (int round = 0; round < 10000; ++round) {
+      std::string source;
+      for (auto count = length(rng); count > 0; --count) {
+        source += fragments[pick(rng)];
+      }
+      REQUIRE(lex(config, source) == lex(reference, source));
+    }
+  }
+}
@@ -3,161 +3,1245 @@
 
 #include <algorithm>
 #include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <expected>
 #include <filesystem>
+#include <format>
+#include <optional>
 #include <print>
 #include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <cxxopts.hpp>
 #include <inja/inja.hpp>
 
+import walng.apply;
 import walng.basexx_theme;
+import walng.builtin_templates;
+import walng.catalog;
 import walng.color;
 import walng.config;
 import walng.download;
+import walng.hash;
+import walng.history;
+import walng.include_cache;
+import walng.native_template;
+import walng.palette_analysis;
+import walng.palette_index;
+import walng.parallel;
+import walng.prerender;
+import walng.render;
+import walng.render_cache;
+import walng.store;
+import walng.template_vm;
 import walng.utils;
 import walng.version;
 
-auto get_inja_env() -> inja::Environment {
-  inja::Environment result;
+/// Render cache from command line, std::nullopt when disabled
+auto get_render_cache(cxxopts::ParseResult const& args) -> std::optional<walng::render_cache> {
+  if (!args.count("render-cache") && !args.count("render-cache-url")) {
+    return std::nullopt;
+  }
+  auto const path = walng::get_render_cache_path();
+  if (!path) {
+    std::print(stderr, "failed to get render cache path ({})\n", path.error());
+    return std::nullopt;
+  }
+  return walng::render_cache(*path, args.count("render-cache-url") ? args["render-cache-url"].as<std::string>() : "");
+}
 
-  result.set_trim_blocks(true);
-  result.set_lstrip_blocks(true);
+/// Print item outcome of apply as it happens
+auto print_apply_item(walng::apply_item_result const& result) -> void {
+  switch (result.status) {
+  case walng::apply_item_status::skipped:
+    std::print(stdout, "skipping '{}' (not affected by theme change)\n", result.name);
+    break;
+  case walng::apply_item_status::rendered:
+  case walng::apply_item_status::installed:
+  case walng::apply_item_status::failed:
+    std::print(stdout, "processing '{}'\n", result.name);
+    break;
+  }
+  if (!result.error.empty()) {
+    std::print(stderr, "{}\n", result.error);
+  }
+}
 
-  result.add_callback("hex", 1, [](inja::Arguments const& args) -> std::string {
-    auto color_result = walng::parse_color_from_hex_str(args.at(0)->get<std::string>());
-    if (!color_result) {
-      throw std::runtime_error(std::string(color_result.error()));
+auto load_config(cxxopts::ParseResult const& args) -> std::expected<walng::config, std::string> {
+  std::filesystem::path config_path;
+  if (args.count("config")) {
+    config_path = args["config"].as<std::string>();
+  } else {
+    auto default_config_path = walng::get_config_path();
+    if (!default_config_path) {
+      return std::unexpected(std::format("failed to get default config file path ({})", default_config_path.error()));
     }
-    return std::string(color_result->as_hex_str().string());
-  });
+    config_path = *default_config_path / "config.yaml";
+  }
+
+  auto config_load_result = walng::load_config_from_yaml_file_cached(config_path);
+  if (!config_load_result) {
+    return std::unexpected(
+        std::format("failed to load config file '{}' ({})", config_path.c_str(), config_load_result.error()));
+  }
+  return {std::move(config_load_result.value())};
+}
 
-  result.add_callback("rgb", 1, [](inja::Arguments const& args) -> std::string {
-    auto color_result = walng::parse_color_from_hex_str(args.at(0)->get<std::string>());
-    if (!color_result) {
-      throw std::runtime_error(std::string(color_result.error()));
+auto get_catalog_path(cxxopts::ParseResult const& args) -> std::expected<std::filesystem::path, std::string> {
+  if (args.count("catalog")) {
+    return std::filesystem::path(args["catalog"].as<std::string>());
+  }
+  return walng::get_default_catalog_path();
+}
+
+auto load_theme(std::string const& theme_spec, std::filesystem::path const& catalog_path,
+    walng::theme_catalog const* loaded_catalog = nullptr) -> std::expected<walng::basexx_theme, std::string> {
+  if (std::filesystem::exists(theme_spec)) {
+    // load from file
+    auto theme_parse_result = walng::basexx_theme_parse_from_yaml_file_cached(theme_spec);
+    if (!theme_parse_result) {
+      return std::unexpected(
+          std::format("failed to load theme from file '{}' ({})", theme_spec, theme_parse_result.error()));
     }
-    auto rgb = color_result->as_rgb();
-    return std::format("{}, {}, {}", rgb.r, rgb.g, rgb.b);
-  });
+    return {std::move(theme_parse_result.value())};
+  }
 
-  result.add_callback("r", 1, [](inja::Arguments const& args) -> std::string {
-    auto color_result = walng::parse_color_from_hex_str(args.at(0)->get<std::string>());
-    if (!color_result) {
-      throw std::runtime_error(std::string(color_result.error()));
+  if (theme_spec.find("://") != theme_spec.npos) {
+    auto download_result = walng::download(theme_spec);
+    if (!download_result) {
+      return std::unexpected(std::format("can't download theme ({})", download_result.error()));
     }
-    auto rgb = color_result->as_rgb();
-    return std::format("{}", rgb.r);
-  });
+    auto const& response = *download_result;
+    if (response.response_code != 200) {
+      return std::unexpected(std::format("download theme error (response_code {})", response.response_code));
+    }
+    if (!response.content) {
+      return std::unexpected("download theme error (no content)");
+    }
+    auto theme_parse_result = walng::basexx_theme_parse_from_yaml_content(*response.content);
+    if (!theme_parse_result) {
+      return std::unexpected(std::format("theme parse error ({})", theme_parse_result.error()));
+    }
+    return {std::move(theme_parse_result.value())};
+  }
 
-  result.add_callback("g", 1, [](inja::Arguments const& args) -> std::string {
-    auto color_result = walng::parse_color_from_hex_str(args.at(0)->get<std::string>());
-    if (!color_result) {
-      throw std::runtime_error(std::string(color_result.error()));
+  // lookup by name in local catalog
+  std::expected<walng::theme_catalog, std::string> own_catalog;
+  if (!loaded_catalog) {
+    own_catalog = walng::load_theme_catalog(catalog_path);
+    if (!own_catalog) {
+      return std::unexpected(std::format("failed to load theme catalog ({})", own_catalog.error()));
     }
-    auto rgb = color_result->as_rgb();
-    return std::format("{}", rgb.g);
-  });
+    loaded_catalog = &own_catalog.value();
+  }
+  auto const& catalog = *loaded_catalog;
+  if (auto const entry = catalog.find(theme_spec); entry) {
+    return entry->theme;
+  }
+
+  auto const matches = catalog.search(theme_spec, 5);
+  if (matches.empty()) {
+    return std::unexpected(std::format("theme '{}' not found", theme_spec));
+  }
+  std::string suggestions;
+  for (auto const& match : matches) {
+    if (!suggestions.empty()) {
+      suggestions.append(", ");
+    }
+    suggestions.append(catalog[match.index].slug);
+  }
+  return std::unexpected(std::format("theme '{}' not found, did you mean: {}", theme_spec, suggestions));
+}
+
+auto run_search(cxxopts::ParseResult const& args) -> int {
+  auto const catalog_path = get_catalog_path(args);
+  if (!catalog_path) {
+    std::print(stderr, "failed to get catalog path ({})\n", catalog_path.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const catalog = walng::load_theme_catalog(*catalog_path);
+  if (!catalog) {
+    std::print(stderr, "failed to load theme catalog ({})\n", catalog.error());
+    return EXIT_FAILURE;
+  }
 
-  result.add_callback("b", 1, [](inja::Arguments const& args) -> std::string {
-    auto color_result = walng::parse_color_from_hex_str(args.at(0)->get<std::string>());
-    if (!color_result) {
-      throw std::runtime_error(std::string(color_result.error()));
+  std::string query;
+  if (args.count("args")) {
+    for (auto const& word : args["args"].as<std::vector<std::string>>()) {
+      if (!query.empty()) {
+        query.append(1, ' ');
+      }
+      query.append(word);
+    }
+  }
+
+  for (auto const& match : catalog->search(query, args["limit"].as<std::size_t>())) {
+    std::print(stdout, "{}\n", (*catalog)[match.index].slug);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+auto parse_palette_list(std::string_view str) -> std::expected<std::vector<walng::color>, std::string> {
+  std::vector<walng::color> result;
+  while (!str.empty()) {
+    auto const found = str.find(',');
+    auto item = str.substr(0, found);
+    str = found == str.npos ? std::string_view() : str.substr(found + 1);
+
+    while (item.starts_with(' ')) {
+      item.remove_prefix(1);
+    }
+    while (item.ends_with(' ')) {
+      item.remove_suffix(1);
+    }
+    if (item.starts_with('#')) {
+      item.remove_prefix(1);
     }
-    auto rgb = color_result->as_rgb();
-    return std::format("{}", rgb.b);
+    if (auto const rc = walng::parse_color_from_stripped_hex_str(item); rc) {
+      result.push_back(*rc);
+    } else {
+      return std::unexpected(std::format("can't parse color '{}', {}", item, rc.error()));
+    }
+  }
+  return {std::move(result)};
+}
+
+auto run_similar(cxxopts::ParseResult const& args) -> int {
+  auto const catalog_path = get_catalog_path(args);
+  if (!catalog_path) {
+    std::print(stderr, "failed to get catalog path ({})\n", catalog_path.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const catalog = walng::load_theme_catalog(*catalog_path);
+  if (!catalog) {
+    std::print(stderr, "failed to load theme catalog ({})\n", catalog.error());
+    return EXIT_FAILURE;
+  }
+
+  std::string theme_spec;
+  std::vector<walng::color> palette;
+  if (args.count("closest-to")) {
+    auto const& value = args["closest-to"].as<std::string>();
+    if (value.starts_with('#')) {
+      auto palette_parse_result = parse_palette_list(value);
+      if (!palette_parse_result) {
+        std::print(stderr, "failed to parse palette ({})\n", palette_parse_result.error());
+        return EXIT_FAILURE;
+      }
+      palette = std::move(palette_parse_result.value());
+    } else {
+      theme_spec = value;
+    }
+  } else if (args.count("args")) {
+    theme_spec = args["args"].as<std::vector<std::string>>().front();
+  } else {
+    std::print(stderr, "theme or `--closest-to` palette is mandatory\n");
+    return EXIT_FAILURE;
+  }
+
+  walng::basexx_theme theme;
+  if (!theme_spec.empty()) {
+    auto theme_load_result = load_theme(theme_spec, *catalog_path, &catalog.value());
+    if (!theme_load_result) {
+      std::print(stderr, "{}\n", theme_load_result.error());
+      return EXIT_FAILURE;
+    }
+    theme = std::move(theme_load_result.value());
+    palette = theme.palette;
+  }
+  if (palette.empty()) {
+    std::print(stderr, "palette is empty\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<walng::packed_palette> packed;
+  packed.reserve(catalog->size());
+  for (auto const& entry : catalog->entries()) {
+    packed.push_back(walng::pack_palette(entry.theme.palette));
+  }
+  walng::packed_palettes const palettes(packed);
+
+  auto const limit = args["limit"].as<std::size_t>();
+  auto const slot_count = std::min(palette.size(), walng::palette_slots);
+  auto const matches = walng::find_nearest_palettes(palettes, walng::pack_palette(palette), limit + 1, slot_count);
+
+  std::size_t printed = 0;
+  for (auto const& match : matches) {
+    auto const& entry = (*catalog)[match.index];
+    if (!theme_spec.empty() && entry.theme.name == theme.name && entry.theme.palette == theme.palette) {
+      // don't report theme itself
+      continue;
+    }
+    if (printed++ == limit) {
+      break;
+    }
+    std::print(stdout, "{} {:.4f}\n", entry.slug, match.distance);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+auto run_dedupe(cxxopts::ParseResult const& args) -> int {
+  auto const catalog_path = get_catalog_path(args);
+  if (!catalog_path) {
+    std::print(stderr, "failed to get catalog path ({})\n", catalog_path.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const catalog = walng::load_theme_catalog(*catalog_path);
+  if (!catalog) {
+    std::print(stderr, "failed to load theme catalog ({})\n", catalog.error());
+    return EXIT_FAILURE;
+  }
+
+  std::vector<walng::packed_palette> packed;
+  packed.reserve(catalog->size());
+  for (auto const& entry : catalog->entries()) {
+    packed.push_back(walng::pack_palette(entry.theme.palette));
+  }
+  walng::packed_palettes const palettes(packed);
+
+  auto const pairs = walng::find_close_palette_pairs(palettes, args["threshold"].as<float>());
+  auto const clusters = walng::cluster_palette_pairs(palettes.size(), pairs);
+
+  for (auto const& cluster : clusters) {
+    std::string line;
+    for (auto const index : cluster) {
+      if (!line.empty()) {
+        line.append(1, ' ');
+      }
+      line.append((*catalog)[index].slug);
+    }
+    std::print(stdout, "{}\n", line);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+auto get_contrast_requirements(cxxopts::ParseResult const& args, std::size_t palette_size)
+    -> std::vector<walng::contrast_requirement> {
+  return walng::get_default_contrast_requirements(
+      palette_size, args["min-contrast"].as<float>(), args["min-accent-contrast"].as<float>());
+}
+
+auto print_contrast_adjustments(std::string_view name, std::span<walng::contrast_adjustment const> adjustments)
+    -> void {
+  for (auto const& adjustment : adjustments) {
+    std::print(stderr, "{}: {} #{} -> #{}\n", name, walng::basexx_theme_color_name(adjustment.index),
+        adjustment.before.as_hex_str().string(), adjustment.after.as_hex_str().string());
+  }
+}
+
+auto print_contrast_report(std::string_view name, walng::contrast_report const& report, bool print_matrix) -> void {
+  if (print_matrix) {
+    std::string line(6, ' ');
+    for (std::size_t column = 0; column < report.matrix.size(); ++column) {
+      line.append(std::format(" {:>6}", walng::basexx_theme_color_name(column)));
+    }
+    std::print(stdout, "{}\n", line);
+    for (std::size_t row = 0; row < report.matrix.size(); ++row) {
+      line = walng::basexx_theme_color_name(row);
+      for (std::size_t column = 0; column < report.matrix.size(); ++column) {
+        line.append(std::format(" {:>6.2f}", report.matrix(row, column)));
+      }
+      std::print(stdout, "{}\n", line);
+    }
+  }
+
+  if (report.failures.empty()) {
+    std::print(stdout, "{}: ok\n", name);
+    return;
+  }
+  std::print(stdout, "{}: {} failing pairs\n", name, report.failures.size());
+  for (auto const& failure : report.failures) {
+    std::print(stdout, "  {} on {}: {:.2f} < {:.2f}\n", walng::basexx_theme_color_name(failure.requirement.foreground),
+        walng::basexx_theme_color_name(failure.requirement.background), failure.ratio, failure.requirement.min_ratio);
+  }
+}
+
+auto run_check(cxxopts::ParseResult const& args) -> int {
+  auto const catalog_path = get_catalog_path(args);
+  if (!catalog_path) {
+    std::print(stderr, "failed to get catalog path ({})\n", catalog_path.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const print_matrix = args.count("matrix") > 0;
+
+  if (!args.count("all")) {
+    std::string theme_spec;
+    if (args.count("args")) {
+      theme_spec = args["args"].as<std::vector<std::string>>().front();
+    } else if (args.count("theme")) {
+      theme_spec = args["theme"].as<std::string>();
+    } else {
+      std::print(stderr, "theme or `--all` is mandatory\n");
+      return EXIT_FAILURE;
+    }
+
+    auto const theme = load_theme(theme_spec, *catalog_path);
+    if (!theme) {
+      std::print(stderr, "{}\n", theme.error());
+      return EXIT_FAILURE;
+    }
+    auto const requirements = get_contrast_requirements(args, theme->palette.size());
+    auto const report = walng::check_contrast(*theme, requirements);
+    print_contrast_report(theme_spec, report, print_matrix);
+    return report.failures.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  auto const catalog = walng::load_theme_catalog(*catalog_path);
+  if (!catalog) {
+    std::print(stderr, "failed to load theme catalog ({})\n", catalog.error());
+    return EXIT_FAILURE;
+  }
+
+  // base16 and base24 themes have different requirement sets
+  auto const base16_requirements = get_contrast_requirements(args, 16);
+  auto const base24_requirements = get_contrast_requirements(args, 24);
+
+  std::vector<walng::contrast_report> reports(catalog->size());
+  walng::parallel_for(catalog->size(), [&](std::size_t index) {
+    auto const& theme = (*catalog)[index].theme;
+    reports[index] =
+        walng::check_contrast(theme, theme.palette.size() >= 24 ? base24_requirements : base16_requirements);
   });
 
-  return result;
+  std::size_t failed = 0;
+  for (std::size_t index = 0; index < reports.size(); ++index) {
+    if (reports[index].failures.empty() && !print_matrix) {
+      continue;
+    }
+    failed += reports[index].failures.empty() ? 0 : 1;
+    print_contrast_report((*catalog)[index].slug, reports[index], print_matrix);
+  }
+  std::print(stdout, "{} of {} themes have failing pairs\n", failed, reports.size());
+
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-auto basexx_theme_to_json(walng::basexx_theme const& theme) -> inja::json {
-  auto json = inja::json::object();
+auto run_repair(cxxopts::ParseResult const& args) -> int {
+  auto const catalog_path = get_catalog_path(args);
+  if (!catalog_path) {
+    std::print(stderr, "failed to get catalog path ({})\n", catalog_path.error());
+    return EXIT_FAILURE;
+  }
+
+  if (!args.count("all")) {
+    std::string theme_spec;
+    if (args.count("args")) {
+      theme_spec = args["args"].as<std::vector<std::string>>().front();
+    } else if (args.count("theme")) {
+      theme_spec = args["theme"].as<std::string>();
+    } else {
+      std::print(stderr, "theme or `--all` is mandatory\n");
+      return EXIT_FAILURE;
+    }
+
+    auto theme = load_theme(theme_spec, *catalog_path);
+    if (!theme) {
+      std::print(stderr, "{}\n", theme.error());
+      return EXIT_FAILURE;
+    }
+    auto const requirements = get_contrast_requirements(args, theme->palette.size());
+    auto const adjustments = walng::repair_contrast(*theme, requirements);
+    print_contrast_adjustments(theme_spec, adjustments);
+
+    auto const content = walng::basexx_theme_to_yaml(*theme);
+    if (!args.count("output")) {
+      std::print(stdout, "{}", content);
+      return EXIT_SUCCESS;
+    }
+    if (auto const rc = walng::write_file(args["output"].as<std::string>(), content); !rc) {
+      std::print(stderr, "failed to write theme ({})\n", rc.error());
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
+  if (!args.count("output")) {
+    std::print(stderr, "argument `--output` is mandatory with `--all`\n");
+    return EXIT_FAILURE;
+  }
+  std::filesystem::path const output_path = args["output"].as<std::string>();
+
+  auto const catalog = walng::load_theme_catalog(*catalog_path);
+  if (!catalog) {
+    std::print(stderr, "failed to load theme catalog ({})\n", catalog.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const base16_requirements = get_contrast_requirements(args, 16);
+  auto const base24_requirements = get_contrast_requirements(args, 24);
+
+  std::vector<std::vector<walng::contrast_adjustment>> adjustments(catalog->size());
+  std::vector<std::string> errors(catalog->size());
+  walng::parallel_for(catalog->size(), [&](std::size_t index) {
+    auto const& entry = (*catalog)[index];
+    auto theme = entry.theme;
+    adjustments[index] =
+        walng::repair_contrast(theme, theme.palette.size() >= 24 ? base24_requirements : base16_requirements);
+    if (adjustments[index].empty()) {
+      return;
+    }
+    auto const path = output_path / (entry.slug + ".yaml");
+    if (auto const rc = walng::write_file(path, walng::basexx_theme_to_yaml(theme)); !rc) {
+      errors[index] = rc.error();
+    }
+  });
+
+  std::size_t repaired = 0;
+  bool failed = false;
+  for (std::size_t index = 0; index < adjustments.size(); ++index) {
+    auto const& slug = (*catalog)[index].slug;
+    if (!errors[index].empty()) {
+      std::print(stderr, "{}: failed to write theme ({})\n", slug, errors[index]);
+      failed = true;
+      continue;
+    }
+    print_contrast_adjustments(slug, adjustments[index]);
+    repaired += adjustments[index].empty() ? 0 : 1;
+  }
+  std::print(stdout, "{} of {} themes repaired\n", repaired, adjustments.size());
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
 
-  json["name"] = theme.name;
-  json["author"] = theme.author;
-  json["variant"] = theme.variant;
-  json["system"] = theme.system;
+/// Rendered file of batch job
+struct batch_output {
+  std::filesystem::path path;
+  std::string content;
+  std::string error;
+};
 
-  auto json_palette = inja::json::object();
+/// Load batch themes from catalog directory or comma-separated list of theme specs
+auto load_batch_themes(std::string const& themes_spec, std::filesystem::path const& catalog_path)
+    -> std::expected<std::vector<std::pair<std::string, walng::basexx_theme>>, std::string> {
+  std::vector<std::pair<std::string, walng::basexx_theme>> result;
 
-  char color_name[7];
-  for (auto const& [index, color] : theme.palette | std::ranges::views::enumerate) {
-    std::format_to_n(color_name, sizeof(color_name), "base{:02X}", index);
-    json_palette[color_name] = std::string("#").append(color.as_hex_str().string());
+  if (std::filesystem::is_directory(themes_spec)) {
+    auto catalog = walng::load_theme_catalog(themes_spec);
+    if (!catalog) {
+      return std::unexpected(std::format("failed to load themes directory ({})", catalog.error()));
+    }
+    result.reserve(catalog->size());
+    for (auto const& entry : catalog->entries()) {
+      result.emplace_back(entry.slug, entry.theme);
+    }
+    return {std::move(result)};
   }
 
-  json["palette"] = json_palette;
+  std::expected<walng::theme_catalog, std::string> catalog = std::unexpected("not loaded");
+  std::string_view specs = themes_spec;
+  while (!specs.empty()) {
+    auto const found = specs.find(',');
+    auto const spec = std::string(specs.substr(0, found));
+    specs = found == specs.npos ? std::string_view() : specs.substr(found + 1);
+    if (spec.empty()) {
+      continue;
+    }
 
-  return json;
+    bool const is_external = std::filesystem::exists(spec) || spec.find("://") != spec.npos;
+    if (!is_external && !catalog) {
+      catalog = walng::load_theme_catalog(catalog_path);
+      if (!catalog) {
+        return std::unexpected(std::format("failed to load theme catalog ({})", catalog.error()));
+      }
+    }
+    auto theme = load_theme(spec, catalog_path, catalog ? &catalog.value() : nullptr);
+    if (!theme) {
+      return std::unexpected(theme.error());
+    }
+    result.emplace_back(is_external ? std::filesystem::path(spec).stem().string() : spec, std::move(theme.value()));
+  }
+  return {std::move(result)};
 }
 
-auto execute_hook(std::string const& shell_exec_cmd, std::string const& hook_cmd) -> std::expected<void, std::string> {
-  auto const found = shell_exec_cmd.find("{}");
-  if (found == shell_exec_cmd.npos) {
-    return std::unexpected("shell command without placeholder");
+auto run_batch(cxxopts::ParseResult const& args) -> int {
+  if (!args.count("output")) {
+    std::print(stderr, "argument `--output` is mandatory\n");
+    return EXIT_FAILURE;
+  }
+  std::filesystem::path const output_path = args["output"].as<std::string>();
+
+  auto const config = load_config(args);
+  if (!config) {
+    std::print(stderr, "{}\n", config.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const catalog_path = get_catalog_path(args);
+  if (!catalog_path) {
+    std::print(stderr, "failed to get catalog path ({})\n", catalog_path.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const themes = load_batch_themes(
+      args.count("themes") ? args["themes"].as<std::string>() : catalog_path->string(), *catalog_path);
+  if (!themes) {
+    std::print(stderr, "{}\n", themes.error());
+    return EXIT_FAILURE;
+  }
+
+  // parse every template once, rendering with parsed templates doesn't touch environment state
+  walng::include_cache includes;
+  inja::Environment env = walng::get_inja_env();
+  includes.attach(env);
+  std::vector<walng::compiled_template> compiled;
+  compiled.reserve(config->items.size());
+  for (auto const& item : config->items) {
+    auto const content = walng::read_template(item.template_path);
+    if (!content) {
+      std::print(stderr, "failed to read template of item '{}' ({})\n", item.name, content.error());
+      return EXIT_FAILURE;
+    }
+    try {
+      compiled.push_back(walng::compile_template(env, item, *content));
+    } catch (std::exception const& e) {
+      std::print(stderr, "failed to parse template of item '{}' ({})\n", item.name, e.what());
+      return EXIT_FAILURE;
+    }
+  }
+  auto const render_cache = get_render_cache(args);
+
+  // workers render, one writer stores files; queue capacity bounds rendered data kept in memory
+  walng::bounded_queue<batch_output> outputs(2 * walng::get_worker_count());
+  std::size_t written = 0;
+  std::size_t failed = 0;
+  std::jthread writer([&] {
+    while (auto output = outputs.pop()) {
+      if (output->error.empty()) {
+        if (auto const rc = walng::write_file(output->path, output->content); !rc) {
+          output->error = rc.error();
+        }
+      }
+      if (!output->error.empty()) {
+        std::print(stderr, "failed to render '{}' ({})\n", output->path.c_str(), output->error);
+        ++failed;
+      } else {
+        ++written;
+      }
+    }
+  });
+
+  auto const render_theme = [&](std::size_t index) {
+    auto const& [theme_name, theme] = (*themes)[index];
+    walng::theme_data_provider const data(theme);
+    for (std::size_t item_index = 0; item_index < compiled.size(); ++item_index) {
+      auto const& item = config->items[item_index];
+      batch_output output;
+      output.path = output_path / theme_name / item.name / item.target_path.filename();
+      try {
+        if (compiled[item_index].native || compiled[item_index].builtin) {
+          // placeholder substitution and generated render functions are cheaper than a render cache lookup
+          walng::render_template_into(output.content, env, compiled[item_index], data);
+        } else {
+          auto const render = [&] {
+            std::string result;
+            walng::render_template_into(result, env, compiled[item_index], data);
+            return result;
+          };
+          std::string cache_error;
+          output.content =
+              render_cache ? render_cache->get_or_render(item.template_path, theme, render, &cache_error) : render();
+          if (!cache_error.empty()) {
+            std::print(stderr, "failed to store render cache entry ({})\n", cache_error);
+          }
+        }
+      } catch (std::exception const& e) {
+        output.error = e.what();
+      }
+      outputs.push(std::move(output));
+    }
+  };
+  try {
+    walng::parallel_for(themes->size(), render_theme);
+  } catch (...) {
+    outputs.close();
+    throw;
   }
+  outputs.close();
+  writer.join();
+
+  std::print(stdout, "{} files rendered for {} themes, {} failed\n", written, themes->size(), failed);
+
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-  auto const command_to_execute =
-      std::string().append(shell_exec_cmd, 0, found).append(hook_cmd).append(shell_exec_cmd, found + 2);
-  if (auto const rc = ::system(command_to_execute.c_str()); rc == -1) {
-    return std::unexpected(std::strerror(errno));
+/// Check path resolves (following existing symlinks) below one of canonical roots
+auto is_path_beneath(std::filesystem::path const& path, std::span<std::filesystem::path const> roots) -> bool {
+  std::error_code ec;
+  auto const resolved = std::filesystem::weakly_canonical(path, ec);
+  if (ec) {
+    return false;
+  }
+  for (auto const& root : roots) {
+    if (root.empty()) {
+      continue;
+    }
+    if (auto const relative = resolved.lexically_relative(root); !relative.empty() && *relative.begin() != "..") {
+      return true;
+    }
   }
+  return false;
+}
 
+/// Check fleet item template and templates it includes are read from tenant root or shared templates directory
+auto check_fleet_template(std::filesystem::path const& template_path, std::span<std::filesystem::path const> roots)
+    -> std::expected<void, std::string> {
+  if (template_path.native().starts_with(walng::builtin_template_scheme)) {
+    return {};
+  }
+  if (!is_path_beneath(template_path, roots)) {
+    return std::unexpected("template is outside of tenant root and shared templates directory");
+  }
+  auto const dependencies = walng::scan_template_dependencies(template_path);
+  if (!dependencies) {
+    return std::unexpected(dependencies.error());
+  }
+  for (auto const& path : *dependencies) {
+    if (!is_path_beneath(path, roots)) {
+      return std::unexpected(
+          std::format("included template '{}' is outside of tenant root and shared templates directory", path.c_str()));
+    }
+  }
   return {};
 }
 
-auto process(walng::config const& config, walng::basexx_theme const& theme) -> std::expected<void, std::string> {
-  try {
-    inja::Environment env = get_inja_env();
-    inja::json const json = basexx_theme_to_json(theme);
+/// Fleet tenant prepared for rendering
+struct fleet_job {
+  walng::basexx_theme theme;
+  /// Canonical tenant root, targets are written below it
+  std::filesystem::path root;
+  /// Owner of written files, set when running as root
+  std::optional<walng::file_owner> owner;
+  /// Shared template index and target path (relative to root) of each item
+  std::vector<std::pair<std::size_t, std::filesystem::path>> renders;
+  std::size_t files = 0;
+  std::size_t bytes = 0;
+  std::string error;
+};
+
+auto run_fleet(cxxopts::ParseResult const& args) -> int {
+  if (!args.count("args")) {
+    std::print(stderr, "fleet manifest path is mandatory\n");
+    return EXIT_FAILURE;
+  }
+  std::filesystem::path const manifest_path = args["args"].as<std::vector<std::string>>().front();
+
+  auto const manifest = walng::load_fleet_manifest_from_yaml_file(manifest_path);
+  if (!manifest) {
+    std::print(stderr, "failed to load fleet manifest '{}' ({})\n", manifest_path.c_str(), manifest.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const catalog_path = get_catalog_path(args);
+  if (!catalog_path) {
+    std::print(stderr, "failed to get catalog path ({})\n", catalog_path.error());
+    return EXIT_FAILURE;
+  }
+
+  std::filesystem::path templates_path;
+  if (!manifest->templates_path.empty()) {
+    std::error_code ec;
+    templates_path = std::filesystem::canonical(manifest->templates_path, ec);
+    if (ec) {
+      std::print(stderr, "failed to resolve templates directory '{}' ({})\n", manifest->templates_path.c_str(),
+          ec.message());
+      return EXIT_FAILURE;
+    }
+  }
+
+  auto const start_time = std::chrono::steady_clock::now();
+
+  // templates are shared by content of template and its includes, tenants with the same templates and engine use
+  // one parsed template
+  walng::include_cache includes;
+  inja::Environment env = walng::get_inja_env();
+  includes.attach(env);
+  std::vector<walng::compiled_template> compiled;
+  std::unordered_map<std::uint64_t, std::size_t> template_indexes;
+  std::size_t template_refs = 0;
+
+  // catalog is loaded by the first tenant which needs it, failure is reported for every such tenant
+  std::optional<std::expected<walng::theme_catalog, std::string>> catalog;
+  std::vector<fleet_job> jobs(manifest->tenants.size());
 
-    auto temp_file_path_result = walng::create_temporary_file_path();
-    if (!temp_file_path_result) {
-      return std::unexpected(std::format("can't create temporary file path ({})", temp_file_path_result.error()));
+  for (std::size_t index = 0; index < jobs.size(); ++index) {
+    auto const& tenant = manifest->tenants[index];
+    auto& job = jobs[index];
+
+    std::error_code ec;
+    job.root = std::filesystem::canonical(tenant.root, ec);
+    if (ec) {
+      job.error = std::format("failed to resolve root '{}' ({})", tenant.root.c_str(), ec.message());
+      continue;
+    }
+    if (::geteuid() == 0) {
+      struct ::stat st;
+      if (::stat(job.root.c_str(), &st) != 0) {
+        job.error = std::format("failed to stat root '{}' ({})", job.root.c_str(), std::strerror(errno));
+        continue;
+      }
+      job.owner = walng::file_owner{st.st_uid, st.st_gid};
     }
+    std::filesystem::path const template_roots[] = {job.root, templates_path};
 
-    for (auto const& item : config.items) {
-      std::print(stdout, "processing '{}'\n", item.name);
+    auto const config = walng::load_config_from_yaml_file(tenant.config_path, tenant.root);
+    if (!config) {
+      job.error = std::format("failed to load config file '{}' ({})", tenant.config_path.c_str(), config.error());
+      continue;
+    }
 
-      // generate
-      env.write(item.template_path, json, temp_file_path_result.value());
+    bool const is_external = std::filesystem::exists(tenant.theme) || tenant.theme.find("://") != tenant.theme.npos;
+    if (!is_external && !catalog) {
+      catalog = walng::load_theme_catalog(*catalog_path);
+    }
+    if (!is_external && !*catalog) {
+      job.error = std::format("failed to load theme catalog ({})", catalog->error());
+      continue;
+    }
+    auto theme = load_theme(tenant.theme, *catalog_path, catalog ? &catalog->value() : nullptr);
+    if (!theme) {
+      job.error = theme.error();
+      continue;
+    }
+    job.theme = std::move(theme.value());
 
-      // remove target file if exists
-      if (std::filesystem::exists(item.target_path)) {
-        std::filesystem::remove(item.target_path);
+    for (auto const& item : config->items) {
+      auto const target_path = (tenant.root / item.target_path).lexically_normal();
+      auto const relative_target_path = target_path.lexically_relative(tenant.root);
+      if (relative_target_path.empty() || *relative_target_path.begin() == "..") {
+        job.error = std::format("target of item '{}' is outside of tenant root", item.name);
+        break;
       }
 
-      // copy file to target path
-      std::filesystem::copy_file(temp_file_path_result.value(), item.target_path);
+      if (auto const rc = check_fleet_template(item.template_path, template_roots); !rc) {
+        job.error = std::format("can't use template of item '{}' ({})", item.name, rc.error());
+        break;
+      }
+      auto const content = walng::read_template(item.template_path);
+      if (!content) {
+        job.error = std::format("failed to read template of item '{}' ({})", item.name, content.error());
+        break;
+      }
+      auto const template_hash = walng::hash_template_tree(item.template_path);
+      if (!template_hash) {
+        job.error = std::format("failed to hash template of item '{}' ({})", item.name, template_hash.error());
+        break;
+      }
 
-      // execute hook if exists
-      if (!item.hook_cmd.empty()) {
-        if (auto result = execute_hook(config.shell_exec_cmd, item.hook_cmd); !result) {
-          std::print(stderr, "failed to execute hook ({})\n", result.error());
+      ++template_refs;
+      auto const template_key = walng::hasher().update(*template_hash).update(item.engine).digest();
+      auto [it, inserted] = template_indexes.try_emplace(template_key, compiled.size());
+      if (inserted) {
+        try {
+          compiled.push_back(walng::compile_template(env, item, *content));
+        } catch (std::exception const& e) {
+          template_indexes.erase(it);
+          job.error = std::format("failed to parse template of item '{}' ({})", item.name, e.what());
+          break;
         }
       }
+      job.renders.emplace_back(it->second, relative_target_path);
     }
-  } catch (std::exception const& e) {
-    return std::unexpected(e.what());
   }
 
-  return {};
+  walng::parallel_for(jobs.size(), [&](std::size_t index) {
+    auto& job = jobs[index];
+    if (!job.error.empty()) {
+      return;
+    }
+    try {
+      walng::theme_data_provider const data(job.theme);
+      std::string content;
+      for (auto const& [template_index, target_path] : job.renders) {
+        content.clear();
+        walng::render_template_into(content, env, compiled[template_index], data);
+        if (auto const rc = walng::write_file_beneath(job.root, target_path, content, job.owner); !rc) {
+          job.error = std::format("failed to write '{}' ({})", (job.root / target_path).c_str(), rc.error());
+          return;
+        }
+        ++job.files;
+        job.bytes += content.size();
+      }
+    } catch (std::exception const& e) {
+      job.error = e.what();
+    }
+  });
+
+  auto const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+  std::size_t failed = 0;
+  std::size_t files = 0;
+  std::size_t bytes = 0;
+  for (std::size_t index = 0; index < jobs.size(); ++index) {
+    auto const& job = jobs[index];
+    files += job.files;
+    bytes += job.bytes;
+    if (!job.error.empty()) {
+      std::print(stderr, "tenant '{}': {}\n", manifest->tenants[index].name, job.error);
+      ++failed;
+    }
+  }
+
+  std::print(stdout, "tenants: {} ok, {} failed\n", jobs.size() - failed, failed);
+  std::print(stdout, "templates: {} unique of {} used\n", compiled.size(), template_refs);
+  std::print(stdout, "files: {} ({} bytes) in {:.3f}s, {:.1f} files/s\n", files, bytes, elapsed,
+      elapsed > 0 ? static_cast<double>(files) / elapsed : 0.0);
+
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+auto run_prerender(cxxopts::ParseResult const& args) -> int {
+  std::string themes_spec;
+  if (args.count("themes")) {
+    themes_spec = args["themes"].as<std::string>();
+  } else if (args.count("args")) {
+    for (auto const& spec : args["args"].as<std::vector<std::string>>()) {
+      themes_spec.append(themes_spec.empty() ? "" : ",").append(spec);
+    }
+  } else {
+    std::print(stderr, "themes to prerender are mandatory\n");
+    return EXIT_FAILURE;
+  }
+
+  auto const config = load_config(args);
+  if (!config) {
+    std::print(stderr, "{}\n", config.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const catalog_path = get_catalog_path(args);
+  if (!catalog_path) {
+    std::print(stderr, "failed to get catalog path ({})\n", catalog_path.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const prerender_path = walng::get_prerender_path();
+  if (!prerender_path) {
+    std::print(stderr, "failed to get prerender path ({})\n", prerender_path.error());
+    return EXIT_FAILURE;
+  }
+  walng::blob_store const store(*prerender_path / "blobs");
+  // unreferenced blobs are pruned after sets are saved, blobs of concurrent run would look unreferenced
+  std::error_code ec;
+  std::filesystem::create_directories(*prerender_path, ec);
+  auto const lock = walng::file_lock::acquire(*prerender_path);
+  if (!lock) {
+    std::print(stderr, "failed to lock prerendered sets ({})\n", lock.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const themes = load_batch_themes(themes_spec, *catalog_path);
+  if (!themes) {
+    std::print(stderr, "{}\n", themes.error());
+    return EXIT_FAILURE;
+  }
+
+  walng::include_cache includes;
+  inja::Environment env = walng::get_inja_env();
+  includes.attach(env);
+  std::vector<walng::compiled_template> compiled;
+  std::vector<std::uint64_t> template_hashes;
+  compiled.reserve(config->items.size());
+  template_hashes.reserve(config->items.size());
+  for (auto const& item : config->items) {
+    auto const content = walng::read_template(item.template_path);
+    if (!content) {
+      std::print(stderr, "failed to read template of item '{}' ({})\n", item.name, content.error());
+      return EXIT_FAILURE;
+    }
+    try {
+      compiled.push_back(walng::compile_template(env, item, *content));
+    } catch (std::exception const& e) {
+      std::print(stderr, "failed to parse template of item '{}' ({})\n", item.name, e.what());
+      return EXIT_FAILURE;
+    }
+    auto const template_hash = walng::hash_template_tree(item.template_path);
+    if (!template_hash) {
+      std::print(stderr, "failed to hash template of item '{}' ({})\n", item.name, template_hash.error());
+      return EXIT_FAILURE;
+    }
+    template_hashes.push_back(*template_hash);
+  }
+  std::vector<std::string> errors(themes->size());
+  walng::parallel_for(themes->size(), [&](std::size_t index) {
+    auto const& theme = (*themes)[index].second;
+    try {
+      walng::theme_data_provider const data(theme);
+      walng::prerender_set set;
+      set.entries.reserve(config->items.size());
+      std::string content;
+      for (std::size_t item_index = 0; item_index < config->items.size(); ++item_index) {
+        auto const& item = config->items[item_index];
+        content.clear();
+        walng::render_template_into(content, env, compiled[item_index], data);
+        auto const blob_hash = store.put(content);
+        if (!blob_hash) {
+          errors[index] = std::format("failed to store item '{}' ({})", item.name, blob_hash.error());
+          return;
+        }
+        set.entries.push_back(
+            walng::prerender_entry{item.name, item.target_path, template_hashes[item_index], *blob_hash});
+      }
+      if (auto const rc = walng::save_prerender_set(*prerender_path, walng::get_prerender_set_key(*config, theme), set);
+          !rc) {
+        errors[index] = std::format("failed to save prerendered set ({})", rc.error());
+      }
+    } catch (std::exception const& e) {
+      errors[index] = e.what();
+    }
+  });
+
+  std::size_t failed = 0;
+  for (std::size_t index = 0; index < errors.size(); ++index) {
+    if (!errors[index].empty()) {
+      std::print(stderr, "{}: {}\n", (*themes)[index].first, errors[index]);
+      ++failed;
+    }
+  }
+  std::print(stdout, "{} of {} themes prerendered\n", themes->size() - failed, themes->size());
+
+  // sets of other configs were replaced, their blobs aren't needed anymore
+  if (auto const removed = walng::prune_prerender_blobs(*prerender_path, store); !removed) {
+    std::print(stderr, "failed to prune prerendered blobs ({})\n", removed.error());
+  } else if (*removed > 0) {
+    std::print(stdout, "{} unused blobs removed\n", *removed);
+  }
+
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+auto run_history() -> int {
+  auto const history_path = walng::get_history_path();
+  if (!history_path) {
+    std::print(stderr, "failed to get history path ({})\n", history_path.error());
+    return EXIT_FAILURE;
+  }
+  auto const history = walng::history::load(*history_path);
+  if (!history) {
+    std::print(stderr, "failed to load history ({})\n", history.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const generations = history->generations();
+  for (std::size_t steps = 0; steps < generations.size(); ++steps) {
+    auto const& generation = generations[generations.size() - 1 - steps];
+    std::print(stdout, "{} {} {:%F %T} {}\n", steps, generation.id,
+        std::chrono::sys_seconds(std::chrono::seconds(generation.timestamp)), generation.theme.name);
+  }
+  return EXIT_SUCCESS;
+}
+
+auto run_rollback(cxxopts::ParseResult const& args) -> int {
+  std::size_t steps = 1;
+  if (args.count("args")) {
+    auto const& value = args["args"].as<std::vector<std::string>>().front();
+    auto const [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), steps);
+    if (ec != std::errc() || ptr != value.data() + value.size()) {
+      std::print(stderr, "invalid number of generations '{}'\n", value);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // rollback is saved as new generation, with no generations to keep it would wipe history
+  auto const keep = args["history"].as<std::size_t>();
+  if (keep == 0) {
+    std::print(stderr, "history is disabled (--history 0)\n");
+    return EXIT_FAILURE;
+  }
+
+  auto const config = load_config(args);
+  if (!config) {
+    std::print(stderr, "{}\n", config.error());
+    return EXIT_FAILURE;
+  }
+
+  auto const history_path = walng::get_history_path();
+  if (!history_path) {
+    std::print(stderr, "failed to get history path ({})\n", history_path.error());
+    return EXIT_FAILURE;
+  }
+
+  bool failed = false;
+  // hooks run after history is saved and its lock is released, slow hook must not block other instances
+  std::vector<std::string> hooks;
+  {
+    auto history = walng::history::load(*history_path);
+    if (!history) {
+      std::print(stderr, "failed to load history ({})\n", history.error());
+      return EXIT_FAILURE;
+    }
+
+    auto const generations = history->generations();
+    if (steps >= generations.size()) {
+      std::print(stderr, "only {} previous generations in history\n", generations.empty() ? 0 : generations.size() - 1);
+      return EXIT_FAILURE;
+    }
+    auto generation = generations[generations.size() - 1 - steps];
+
+    std::print(stdout, "restoring generation {} ({})\n", generation.id, generation.theme.name);
+    for (auto const& entry : generation.entries) {
+      std::print(stdout, "processing '{}'\n", entry.name);
+      if (auto const rc = walng::install_file_atomic(history->store().path(entry.blob_hash), entry.target_path); !rc) {
+        std::print(stderr, "failed to restore '{}' ({})\n", entry.target_path.c_str(), rc.error());
+        failed = true;
+        continue;
+      }
+      if (!entry.hook_cmd.empty()) {
+        hooks.push_back(entry.hook_cmd);
+      }
+    }
+
+    // rollback is a new generation, so it can be rolled back as well
+    if (auto const rc = history->push(std::move(generation), keep); !rc) {
+      std::print(stderr, "failed to save history ({})\n", rc.error());
+    }
+  }
+
+  for (auto const& hook_cmd : hooks) {
+    if (auto result = walng::execute_hook(config->shell_exec_cmd, hook_cmd); !result) {
+      std::print(stderr, "failed to execute hook ({})\n", result.error());
+    }
+  }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/// Human readable list of theme data
+auto format_theme_usage(walng::theme_usage const& usage) -> std::string {
+  std::string result;
+  auto const append = [&result](std::string_view value) {
+    result.append(result.empty() ? "" : " ").append(value);
+  };
+
+  if (usage.palette == walng::theme_usage_all.palette) {
+    append("palette");
+  } else {
+    for (std::size_t index = 0; index < 24; ++index) {
+      if (usage.palette & (1u << index)) {
+        append(walng::basexx_theme_color_name(index));
+      }
+    }
+  }
+  if (usage.fields & walng::theme_field_name) {
+    append("name");
+  }
+  if (usage.fields & walng::theme_field_author) {
+    append("author");
+  }
+  if (usage.fields & walng::theme_field_variant) {
+    append("variant");
+  }
+  if (usage.fields & walng::theme_field_system) {
+    append("system");
+  }
+  return result.empty() ? "-" : result;
+}
+
+auto run_deps(cxxopts::ParseResult const& args) -> int {
+  auto const config = load_config(args);
+  if (!config) {
+    std::print(stderr, "{}\n", config.error());
+    return EXIT_FAILURE;
+  }
+
+  walng::include_cache includes;
+  inja::Environment env = walng::get_inja_env();
+  includes.attach(env);
+  bool failed = false;
+  for (auto const& item : config->items) {
+    try {
+      if (item.engine == walng::template_engine::native) {
+        auto const content = walng::read_template(item.template_path);
+        if (!content) {
+          throw std::runtime_error(content.error());
+        }
+        auto const native = walng::native_template::parse(*content);
+        if (!native) {
+          throw std::runtime_error(native.error());
+        }
+        std::print(stdout, "{}: {}\n", item.name, format_theme_usage(native->usage()));
+        continue;
+      }
+      auto const tmpl = walng::parse_template(env, item.template_path);
+      std::print(stdout, "{}: {}\n", item.name, format_theme_usage(walng::analyze_template(tmpl, env, includes)));
+    } catch (std::exception const& e) {
+      std::print(stderr, "failed to parse template of item '{}' ({})\n", item.name, e.what());
+      failed = true;
+    }
+  }
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 int main(int argc, char* argv[]) {
   try {
-    cxxopts::Options options("walng", "color template generator for base16 framework\n");
+    cxxopts::Options options("walng", "color template generator for base16 framework\n\n"
+                                      "commands:\n"
+                                      "  apply            render templates with theme (default)\n"
+                                      "  search [QUERY]   fuzzy search themes in catalog\n"
+                                      "  similar THEME    find catalog themes with closest palettes\n"
+                                      "  dedupe           print groups of near-identical catalog themes\n"
+                                      "  check [THEME]    report WCAG contrast of theme (or catalog with --all)\n"
+                                      "  repair [THEME]   fix contrast of theme (or catalog with --all --output DIR)\n"
+                                      "  batch            render every theme with every template into --output DIR\n"
+                                      "  fleet MANIFEST   render configs and themes of many tenants (without hooks)\n"
+                                      "  prerender THEMES render themes ahead of time for instant apply\n"
+                                      "  history          list applied generations\n"
+                                      "  rollback [N]     restore generation applied N applies ago (default 1)\n"
+                                      "  deps             report theme data read by every configured template\n");
+    options.positional_help("[COMMAND] [ARGS...]");
 
     // clang-format off
     options.add_options()
       ("config", "path to config file", cxxopts::value<std::string>(), "PATH")
-      ("theme", "path or url to theme file", cxxopts::value<std::string>(), "PATH or URL")
+      ("theme", "path, url or catalog name of theme", cxxopts::value<std::string>(), "PATH, URL or NAME")
+      ("catalog", "path to themes catalog directory", cxxopts::value<std::string>(), "PATH")
+      ("closest-to", "find catalog themes closest to palette (#rrggbb,#rrggbb,... or theme)",
+        cxxopts::value<std::string>(), "PALETTE")
+      ("limit", "max number of search results", cxxopts::value<std::size_t>()->default_value("10"), "N")
+      ("threshold", "max palette distance of duplicates", cxxopts::value<float>()->default_value("0.02"), "DISTANCE")
+      ("min-contrast", "min contrast ratio of text on backgrounds", cxxopts::value<float>()->default_value("4.5"),
+        "RATIO")
+      ("min-accent-contrast", "min contrast ratio of accents on backgrounds",
+        cxxopts::value<float>()->default_value("3.0"), "RATIO")
+      ("matrix", "print full contrast matrix")
+      ("all", "check or repair every theme in catalog")
+      ("repair", "repair contrast of theme before rendering")
+      ("output", "output path of repaired theme(s) or rendered batch", cxxopts::value<std::string>(), "PATH")
+      ("themes", "themes directory or comma-separated list of themes for batch or prerender",
+        cxxopts::value<std::string>(), "DIR or LIST")
+      ("history", "number of applied generations to keep (0 disables history)",
+        cxxopts::value<std::size_t>()->default_value("10"), "N")
+      ("render-cache", "reuse rendered outputs from local render cache")
+      ("stats", "print rendering stats (memoized callback calls) after apply")
+      ("render-cache-url", "share render cache through HTTP server (GET / PUT URL/KEY)", cxxopts::value<std::string>(),
+        "URL")
       ("help", "prints the help and exit")
       ("version", "prints the version and exit")
+      ("command", "command to run", cxxopts::value<std::string>()->default_value("apply"))
+      ("args", "command arguments", cxxopts::value<std::vector<std::string>>())
     ;
     // clang-format on
+    options.parse_positional({"command", "args"});
 
     auto const result = options.parse(argc, argv);
 
@@ -170,21 +1254,48 @@ int main(int argc, char* argv[]) {
       return EXIT_FAILURE;
     }
 
-    std::filesystem::path config_path;
-    if (result.count("config")) {
-      config_path = result["config"].as<std::string>();
-    } else {
-      auto default_config_path = walng::get_config_path();
-      if (!default_config_path) {
-        std::print(stderr, "failed to get default config file path ({})\n", default_config_path.error());
-        return EXIT_FAILURE;
-      }
-      config_path = *default_config_path / "config.yaml";
+    auto const& command = result["command"].as<std::string>();
+    if (command == "search") {
+      return run_search(result);
+    }
+    if (command == "similar" || result.count("closest-to")) {
+      return run_similar(result);
+    }
+    if (command == "dedupe") {
+      return run_dedupe(result);
+    }
+    if (command == "check") {
+      return run_check(result);
+    }
+    if (command == "repair") {
+      return run_repair(result);
+    }
+    if (command == "batch") {
+      return run_batch(result);
+    }
+    if (command == "fleet") {
+      return run_fleet(result);
+    }
+    if (command == "prerender") {
+      return run_prerender(result);
+    }
+    if (command == "history") {
+      return run_history();
+    }
+    if (command == "rollback") {
+      return run_rollback(result);
+    }
+    if (command == "deps") {
+      return run_deps(result);
+    }
+    if (command != "apply") {
+      std::print(stderr, "unknown command '{}'\n", command);
+      return EXIT_FAILURE;
     }
 
-    auto config_load_result = walng::load_config_from_yaml_file(config_path);
+    auto config_load_result = load_config(result);
     if (!config_load_result) {
-      std::print(stderr, "failed to load config file '{}' ({})\n", config_path.c_str(), config_load_result.error());
+      std::print(stderr, "{}\n", config_load_result.error());
       return EXIT_FAILURE;
     }
 
@@ -192,39 +1303,22 @@ int main(int argc, char* argv[]) {
       std::print(stderr, "argument `--theme` is mandatory\n");
       return EXIT_FAILURE;
     }
-    auto const& theme_file_or_url = result["theme"].as<std::string>();
 
-    walng::basexx_theme theme;
+    auto const catalog_path = get_catalog_path(result);
+    if (!catalog_path) {
+      std::print(stderr, "failed to get catalog path ({})\n", catalog_path.error());
+      return EXIT_FAILURE;
+    }
 
-    if (std::filesystem::exists(theme_file_or_url)) {
-      // load from file
-      auto theme_parse_result = walng::basexx_theme_parse_from_yaml_file(theme_file_or_url);
-      if (!theme_parse_result) {
-        std::print(stderr, "failed to load theme from file '{}' ([])\n", theme_file_or_url, theme_parse_result.error());
-        return EXIT_FAILURE;
-      }
-      theme = std::move(theme_parse_result.value());
-    } else {
-      auto download_result = walng::download(theme_file_or_url);
-      if (!download_result) {
-        std::print(stderr, "can't download theme ({})\n", download_result.error());
-        return EXIT_FAILURE;
-      }
-      auto const& response = *download_result;
-      if (response.response_code != 200) {
-        std::print(stderr, "download theme error (response_code {})\n", response.response_code);
-        return EXIT_FAILURE;
-      }
-      if (!response.content) {
-        std::print(stderr, "download theme error (no content)\n");
-        return EXIT_FAILURE;
-      }
-      auto theme_parse_result = walng::basexx_theme_parse_from_yaml_content(*response.content);
-      if (!theme_parse_result) {
-        std::print(stderr, "theme parse error ({})\n", theme_parse_result.error());
-        return EXIT_FAILURE;
-      }
-      theme = std::move(theme_parse_result.value());
+    auto theme_load_result = load_theme(result["theme"].as<std::string>(), *catalog_path);
+    if (!theme_load_result) {
+      std::print(stderr, "{}\n", theme_load_result.error());
+      return EXIT_FAILURE;
+    }
+    auto& theme = theme_load_result.value();
+    if (result.count("repair")) {
+      auto const requirements = get_contrast_requirements(result, theme.palette.size());
+      print_contrast_adjustments(theme.name, walng::repair_contrast(theme, requirements));
     }
 
 #if 0
@@ -239,8 +1333,24 @@ int main(int argc, char* argv[]) {
     }
 #endif
 
-    if (auto result = process(config_load_result.value(), theme); !result) {
-      std::print(stderr, "failed to process ({})\n", result.error());
+    auto const render_cache = get_render_cache(result);
+    walng::apply_options apply_options;
+    apply_options.history_size = result["history"].as<std::size_t>();
+    apply_options.cache = render_cache ? &render_cache.value() : nullptr;
+    apply_options.prerendered = true;
+    apply_options.on_item = print_apply_item;
+    auto const report = walng::apply_config(config_load_result.value(), theme, apply_options);
+    if (!report) {
+      std::print(stderr, "failed to process ({})\n", report.error());
+      return EXIT_SUCCESS;
+    }
+    for (auto const& warning : report->warnings) {
+      std::print(stderr, "{}\n", warning);
+    }
+    if (result.count("stats") && !report->prerendered) {
+      std::print(stdout, "callbacks: {} computed, {} from memo\n", report->callbacks_computed,
+          report->callbacks_memoized);
+      std::print(stdout, "includes: {} parsed, {} from cache\n", report->includes_parsed, report->includes_shared);
     }
 
   } catch (std::exception const& e) {
@@ -0,0 +1,138 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <inja/inja.hpp>
+
+import walng.basexx_theme;
+import walng.render;
+
+module walng.native_template;
+
+namespace walng {
+namespace {
+
+constexpr std::array<std::string_view, 5> field_names = {"palette", "name", "author", "variant", "system"};
+
+/// Value of placeholder name: palette slot or 24 + field index
+auto parse_placeholder_name(std::string_view name) -> std::optional<std::uint32_t> {
+  constexpr std::string_view palette_prefix = "palette.";
+  if (name.starts_with(palette_prefix)) {
+    auto const key = name.substr(palette_prefix.size());
+    for (std::uint32_t index = 0; index < 24; ++index) {
+      if (basexx_theme_color_name(index) == key) {
+        return index;
+      }
+    }
+    return std::nullopt;
+  }
+  // palette as a whole is not a string
+  for (std::uint32_t index = 1; index < field_names.size(); ++index) {
+    if (name == field_names[index]) {
+      return 24 + index;
+    }
+  }
+  return std::nullopt;
+}
+
+auto get_line_number(std::string_view source, std::size_t offset) -> std::size_t {
+  return static_cast<std::size_t>(std::ranges::count(source.substr(0, offset), '\n')) + 1;
+}
+
+} // namespace
+
+auto native_template::parse(std::string_view source) -> std::expected<native_template, std::string> {
+  if (source.size() > std::numeric_limits<std::uint32_t>::max()) {
+    return std::unexpected("template is too large");
+  }
+
+  native_template result;
+  result.text_.reserve(source.size());
+
+  std::size_t position = 0;
+  while (position < source.size()) {
+    auto const open = source.find('{', position);
+    if (open == source.npos || open + 1 == source.size()) {
+      break;
+    }
+    auto const next = source[open + 1];
+    if (next == '%' || next == '#') {
+      return std::unexpected(std::format("statements and comments are not supported by native engine (line {})",
+          get_line_number(source, open)));
+    }
+    if (next != '{') {
+      result.text_.append(source.substr(position, open + 1 - position));
+      position = open + 1;
+      continue;
+    }
+
+    auto const close = source.find("}}", open + 2);
+    if (close == source.npos) {
+      return std::unexpected(std::format("unterminated placeholder (line {})", get_line_number(source, open)));
+    }
+    auto name = source.substr(open + 2, close - open - 2);
+    name.remove_prefix(std::min(name.find_first_not_of(" \t"), name.size()));
+    name.remove_suffix(name.size() - std::min(name.find_last_not_of(" \t") + 1, name.size()));
+    auto const value = parse_placeholder_name(name);
+    if (!value) {
+      return std::unexpected(std::format("unsupported placeholder '{}' (line {}), use inja engine for expressions",
+          source.substr(open, close + 2 - open), get_line_number(source, open)));
+    }
+
+    result.text_.append(source.substr(position, open - position));
+    result.placeholders_.push_back(placeholder{static_cast<std::uint32_t>(result.text_.size()), *value});
+    if (*value < field_value) {
+      result.usage_.palette |= 1u << *value;
+    } else {
+      // theme_field bits follow field order: name, author, variant, system
+      result.usage_.fields |= 1u << (*value - field_value - 1);
+    }
+    position = close + 2;
+  }
+  result.text_.append(source.substr(position));
+  result.text_.shrink_to_fit();
+
+  return {std::move(result)};
+}
+
+auto native_template::render_to(std::string& output, theme_data_provider const& data) const -> void {
+  auto const get_value = [&data](std::uint32_t value) -> std::string const& {
+    if (value >= field_value) {
+      return data.field(value - field_value)->get_ref<std::string const&>();
+    }
+    if (value >= data.palette_size()) {
+      throw std::runtime_error(std::format("variable 'palette.{}' not found", basexx_theme_color_name(value)));
+    }
+    return data.slot(value)->get_ref<std::string const&>();
+  };
+
+  // output size is known upfront, so output grows at most once and spans are plain copies
+  auto size = output.size() + text_.size();
+  for (auto const& item : placeholders_) {
+    size += get_value(item.value).size();
+  }
+  output.reserve(size);
+
+  std::size_t offset = 0;
+  for (auto const& item : placeholders_) {
+    output.append(text_, offset, item.offset - offset);
+    output.append(get_value(item.value));
+    offset = item.offset;
+  }
+  output.append(text_, offset);
+}
+
+} // namespace walng
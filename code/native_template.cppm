@@ -0,0 +1,58 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+import walng.render;
+
+export module walng.native_template;
+
+namespace walng {
+
+/// Template of walng native engine
+/// Text with `{{ palette.baseXX }}`, `{{ name }}`, `{{ author }}`, `{{ variant }}` and `{{ system }}` placeholders;
+/// everything else is copied verbatim (no statements, comments, callbacks or whitespace control). Placeholders are
+/// resolved to an offset table at load time, rendering copies static text and preformatted theme strings.
+export class native_template {
+private:
+  /// Placeholder cut out of text_ at offset
+  struct placeholder {
+    std::uint32_t offset;
+    /// Palette slot (< 24) or field_value + theme field (see theme_data_provider::field)
+    std::uint32_t value;
+  };
+
+  static constexpr std::uint32_t field_value = 24;
+
+  /// Static text of template without placeholders
+  std::string text_;
+  /// Placeholders ordered by offset
+  std::vector<placeholder> placeholders_;
+  theme_usage usage_;
+
+public:
+  /// Parse template source, unsupported placeholders are reported with line number
+  [[nodiscard]] static auto parse(std::string_view source) -> std::expected<native_template, std::string>;
+
+  /// Theme data read by template
+  auto usage() const noexcept -> theme_usage const& {
+    return usage_;
+  }
+
+  /// Append rendered template to output, palette slots missing in theme are thrown as std::runtime_error
+  auto render_to(std::string& output, theme_data_provider const& data) const -> void;
+
+  [[nodiscard]] auto render(theme_data_provider const& data) const -> std::string {
+    std::string result;
+    render_to(result, data);
+    return result;
+  }
+};
+
+} // namespace walng
@@ -0,0 +1,86 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include <doctest/doctest.h>
+#include <inja/inja.hpp>
+
+import walng.basexx_theme;
+import walng.color;
+import walng.native_template;
+import walng.render;
+
+namespace {
+
+auto make_theme(std::size_t size) -> walng::basexx_theme {
+  walng::basexx_theme result;
+  result.name = "Test";
+  result.author = "walng";
+  result.variant = "dark";
+  result.system = size > 16 ? "base24" : "base16";
+  for (std::uint32_t index = 0; index < size; ++index) {
+    result.palette.push_back(walng::color{0x102030u + index * 0x070503u});
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("native template renders like inja") {
+  auto env = walng::get_inja_env();
+  walng::theme_data_provider const data(make_theme(24));
+
+  for (std::string const source : {
+           "",
+           "plain text without placeholders\n",
+           "{{ palette.base00 }}",
+           "{{name}} by {{  author\t}} ({{ variant }}, {{ system }})\n",
+           "bg = \"{{ palette.base00 }}\"\nfg = \"{{ palette.base05 }}\"\naccent = {{ palette.base17 }}",
+           "json { \"key\": \"{{ palette.base0A }}\" } and { single } braces {",
+       }) {
+    auto const tmpl = walng::native_template::parse(source);
+    REQUIRE(tmpl);
+    CHECK(tmpl->render(data) == env.render(source, data.data()));
+  }
+}
+
+TEST_CASE("native template reports theme usage") {
+  auto const tmpl =
+      walng::native_template::parse("{{ palette.base00 }}{{ palette.base0F }}{{ palette.base12 }}{{ name }}");
+  REQUIRE(tmpl);
+  CHECK(tmpl->usage().palette == ((1u << 0x00) | (1u << 0x0F) | (1u << 0x12)));
+  CHECK(tmpl->usage().fields == walng::theme_field_name);
+
+  auto const text = walng::native_template::parse("no placeholders");
+  REQUIRE(text);
+  CHECK(text->usage().empty());
+}
+
+TEST_CASE("native template rejects unsupported syntax with line number") {
+  auto const check_error = [](std::string const& source, std::string const& expected) {
+    auto const tmpl = walng::native_template::parse(source);
+    REQUIRE_FALSE(tmpl);
+    CHECK(tmpl.error().find(expected) != std::string::npos);
+  };
+
+  check_error("{% if true %}x{% endif %}", "statements and comments are not supported by native engine (line 1)");
+  check_error("a\nb\n{# comment #}", "(line 3)");
+  check_error("\n{{ palette.base00 ", "unterminated placeholder (line 2)");
+  check_error("{{ rgb(palette.base00) }}", "unsupported placeholder '{{ rgb(palette.base00) }}' (line 1)");
+  check_error("{{ palette }}", "unsupported placeholder");
+  check_error("{{ palette.base18 }}", "unsupported placeholder");
+  check_error("{{ title }}", "unsupported placeholder");
+}
+
+TEST_CASE("native template throws on palette slot missing in theme") {
+  auto const tmpl = walng::native_template::parse("{{ palette.base10 }}");
+  REQUIRE(tmpl);
+  walng::theme_data_provider const base16(make_theme(16));
+  CHECK_THROWS_AS(tmpl->render(base16), std::runtime_error);
+  walng::theme_data_provider const base24(make_theme(24));
+  CHECK(tmpl->render(base24) == std::string("#") + walng::color{0x102030u + 0x10 * 0x070503u}.as_hex_str().value);
+}
@@ -0,0 +1,180 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <span>
+#include <vector>
+
+import walng.basexx_theme;
+import walng.color;
+
+module walng.palette_analysis;
+
+namespace walng {
+namespace {
+
+/// Number of bisection steps, enough to reach 8-bit channel precision
+constexpr int repair_iterations = 24;
+
+/// Backgrounds of one foreground, luminance is biased by 0.05 as in contrast ratio formula
+struct repair_constraints {
+  std::vector<float> luminance;
+  std::vector<float> min_ratio;
+
+  /// min(ratio / min_ratio), requirements are met when >= 1
+  auto score(color value) const noexcept -> float {
+    auto const lhs = value.relative_luminance() + 0.05f;
+    auto result = std::numeric_limits<float>::max();
+    for (std::size_t i = 0; i < luminance.size(); ++i) {
+      auto const rhs = luminance[i];
+      result = std::min(result, std::max(lhs, rhs) / std::min(lhs, rhs) / min_ratio[i]);
+    }
+    return result;
+  }
+};
+
+/// Find color with lightness closest to origin in direction of target lightness which meets constraints
+auto solve_lightness(color_oklch const& origin, float target, repair_constraints const& constraints)
+    -> std::optional<color> {
+  auto const target_color = color::from_oklch(color_oklch{target, origin.c, origin.h});
+  if (constraints.score(target_color) < 1.0f) {
+    return std::nullopt;
+  }
+  // invariant: low fails, high passes
+  float low = origin.l;
+  float high = target;
+  color result = target_color;
+  for (int i = 0; i < repair_iterations; ++i) {
+    auto const middle = 0.5f * (low + high);
+    auto const candidate = color::from_oklch(color_oklch{middle, origin.c, origin.h});
+    if (constraints.score(candidate) >= 1.0f) {
+      high = middle;
+      result = candidate;
+    } else {
+      low = middle;
+    }
+  }
+  return result;
+}
+
+} // namespace
+
+contrast_matrix::contrast_matrix(std::span<color const> palette)
+    : size_(palette.size()), values_(palette.size() * palette.size()) {
+  std::vector<float> luminance(size_);
+  for (std::size_t i = 0; i < size_; ++i) {
+    luminance[i] = palette[i].relative_luminance() + 0.05f;
+  }
+
+  // branch free rows (max / min / div), vectorized by compiler
+  for (std::size_t row = 0; row < size_; ++row) {
+    auto const lhs = luminance[row];
+    float* const values = values_.data() + row * size_;
+    for (std::size_t column = 0; column < size_; ++column) {
+      auto const rhs = luminance[column];
+      values[column] = std::max(lhs, rhs) / std::min(lhs, rhs);
+    }
+  }
+}
+
+auto get_default_contrast_requirements(std::size_t palette_size, float min_text_ratio, float min_accent_ratio)
+    -> std::vector<contrast_requirement> {
+  std::vector<contrast_requirement> result;
+
+  std::vector<std::size_t> backgrounds = {0x00, 0x01};
+  std::vector<std::size_t> accents = {0x04, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+  if (palette_size >= 24) {
+    backgrounds.insert(backgrounds.end(), {0x10, 0x11});
+    accents.insert(accents.end(), {0x12, 0x13, 0x14, 0x15, 0x16, 0x17});
+  }
+
+  for (auto const background : backgrounds) {
+    for (auto const foreground : {0x05, 0x06, 0x07}) {
+      result.push_back(contrast_requirement{static_cast<std::size_t>(foreground), background, min_text_ratio});
+    }
+    for (auto const foreground : accents) {
+      result.push_back(contrast_requirement{foreground, background, min_accent_ratio});
+    }
+  }
+  // selected text
+  result.push_back(contrast_requirement{0x05, 0x02, min_text_ratio});
+
+  std::erase_if(result, [&](contrast_requirement const& requirement) {
+    return requirement.foreground >= palette_size || requirement.background >= palette_size;
+  });
+  return result;
+}
+
+auto check_contrast(basexx_theme const& theme, std::span<contrast_requirement const> requirements)
+    -> contrast_report {
+  contrast_report result{contrast_matrix(theme.palette), {}};
+  for (auto const& requirement : requirements) {
+    if (requirement.foreground >= result.matrix.size() || requirement.background >= result.matrix.size()) {
+      continue;
+    }
+    auto const ratio = result.matrix(requirement.foreground, requirement.background);
+    if (ratio < requirement.min_ratio) {
+      result.failures.push_back(contrast_failure{requirement, ratio});
+    }
+  }
+  return result;
+}
+
+auto repair_contrast(basexx_theme& theme, std::span<contrast_requirement const> requirements)
+    -> std::vector<contrast_adjustment> {
+  std::vector<contrast_adjustment> result;
+  auto& palette = theme.palette;
+
+  std::vector<bool> is_background(palette.size(), false);
+  for (auto const& requirement : requirements) {
+    if (requirement.background < palette.size()) {
+      is_background[requirement.background] = true;
+    }
+  }
+
+  repair_constraints constraints;
+  for (std::size_t foreground = 0; foreground < palette.size(); ++foreground) {
+    if (is_background[foreground]) {
+      continue;
+    }
+
+    constraints.luminance.clear();
+    constraints.min_ratio.clear();
+    for (auto const& requirement : requirements) {
+      if (requirement.foreground == foreground && requirement.background < palette.size()) {
+        constraints.luminance.push_back(palette[requirement.background].relative_luminance() + 0.05f);
+        constraints.min_ratio.push_back(requirement.min_ratio);
+      }
+    }
+    if (constraints.luminance.empty() || constraints.score(palette[foreground]) >= 1.0f) {
+      continue;
+    }
+
+    auto const origin = palette[foreground].as_oklch();
+    auto const darker = solve_lightness(origin, 0.0f, constraints);
+    auto const lighter = solve_lightness(origin, 1.0f, constraints);
+
+    std::optional<color> repaired;
+    if (darker && lighter) {
+      auto const darker_shift = origin.l - darker->as_oklab().l;
+      auto const lighter_shift = lighter->as_oklab().l - origin.l;
+      repaired = darker_shift <= lighter_shift ? darker : lighter;
+    } else {
+      repaired = darker ? darker : lighter;
+    }
+
+    if (repaired && *repaired != palette[foreground]) {
+      result.push_back(contrast_adjustment{foreground, palette[foreground], *repaired});
+      palette[foreground] = *repaired;
+    }
+  }
+
+  return result;
+}
+
+} // namespace walng
@@ -0,0 +1,81 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+import walng.basexx_theme;
+import walng.color;
+
+export module walng.palette_analysis;
+
+namespace walng {
+
+/// WCAG contrast ratios between every pair of palette colors
+export class contrast_matrix {
+private:
+  std::size_t size_ = 0;
+  std::vector<float> values_;
+
+public:
+  contrast_matrix() = default;
+
+  explicit contrast_matrix(std::span<color const> palette);
+
+  auto size() const noexcept -> std::size_t {
+    return size_;
+  }
+
+  /// Contrast ratio [1..21], symmetric
+  auto operator()(std::size_t foreground, std::size_t background) const noexcept -> float {
+    return values_[foreground * size_ + background];
+  }
+};
+
+/// Foreground / background pair which must reach minimal contrast ratio
+export struct contrast_requirement {
+  std::size_t foreground;
+  std::size_t background;
+  float min_ratio;
+};
+
+/// Pairs from base16 styling guide
+/// Text (base05..base07, base05 on selection base02) must reach min_text_ratio, accents (base08..base0F,
+/// base12..base17) and status bar text (base04) must reach min_accent_ratio on default and lighter backgrounds
+/// (base00, base01, base10, base11). Comments (base03) are muted on purpose and not checked.
+export [[nodiscard]] auto get_default_contrast_requirements(std::size_t palette_size, float min_text_ratio = 4.5f,
+    float min_accent_ratio = 3.0f) -> std::vector<contrast_requirement>;
+
+/// Requirement that is not met
+export struct contrast_failure {
+  contrast_requirement requirement;
+  float ratio;
+};
+
+/// Accessibility report of theme
+export struct contrast_report {
+  contrast_matrix matrix;
+  std::vector<contrast_failure> failures;
+};
+
+/// Compute contrast matrix of theme and check requirements against it
+export [[nodiscard]] auto check_contrast(basexx_theme const& theme, std::span<contrast_requirement const> requirements)
+    -> contrast_report;
+
+/// Palette color changed by contrast repair
+export struct contrast_adjustment {
+  std::size_t index;
+  color before;
+  color after;
+};
+
+/// Shift OKLCH lightness of foreground colors (chroma and hue are kept) until requirements are met
+/// The smallest lightness shift which meets all requirements of a foreground is found by bisection. Backgrounds are
+/// never changed; foregrounds which can't meet requirements at any lightness are left as is.
+export auto repair_contrast(basexx_theme& theme, std::span<contrast_requirement const> requirements)
+    -> std::vector<contrast_adjustment>;
+
+} // namespace walng
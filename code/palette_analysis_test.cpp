@@ -0,0 +1,116 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+import walng.basexx_theme;
+import walng.color;
+import walng.palette_analysis;
+
+namespace {
+
+/// Dark theme where every default requirement is met
+auto make_theme() -> walng::basexx_theme {
+  walng::basexx_theme result;
+  result.name = "Test";
+  result.author = "walng";
+  result.variant = "dark";
+  result.system = "base16";
+  for (std::uint32_t const value : {0x1d2021u, 0x282828u, 0x3c3836u, 0x665c54u, 0xbdae93u, 0xd5c4a1u, 0xebdbb2u,
+           0xfbf1c7u, 0xfb4934u, 0xfe8019u, 0xfabd2fu, 0xb8bb26u, 0x8ec07cu, 0x83a598u, 0xd3869bu, 0xd65d0eu}) {
+    result.palette.push_back(walng::color{value});
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("contrast matrix holds WCAG ratios") {
+  std::vector<walng::color> const palette = {walng::color{0x000000u}, walng::color{0xffffffu}, walng::color{0x777777u}};
+  walng::contrast_matrix const matrix(palette);
+  REQUIRE(matrix.size() == 3);
+
+  CHECK(matrix(0, 1) == doctest::Approx(21.0f).epsilon(1e-3));
+  CHECK(matrix(1, 0) == matrix(0, 1));
+  CHECK(matrix(2, 2) == 1.0f);
+  // #777777 on white is just below 4.5
+  CHECK(matrix(2, 1) == doctest::Approx(4.48f).epsilon(1e-2));
+}
+
+TEST_CASE("default requirements follow palette size") {
+  auto const base16 = walng::get_default_contrast_requirements(16);
+  auto const base24 = walng::get_default_contrast_requirements(24);
+  CHECK(base16.size() == 2 * (3 + 9) + 1);
+  CHECK(base24.size() == 4 * (3 + 15) + 1);
+  for (auto const& requirement : base16) {
+    CHECK(requirement.foreground < 16);
+    CHECK(requirement.background < 16);
+    CHECK(requirement.foreground != 0x03);
+  }
+}
+
+TEST_CASE("contrast check reports failed requirements") {
+  auto theme = make_theme();
+  auto const requirements = walng::get_default_contrast_requirements(theme.palette.size());
+  CHECK(walng::check_contrast(theme, requirements).failures.empty());
+
+  theme.palette[0x0D] = walng::color{0x303a40u};
+  auto const report = walng::check_contrast(theme, requirements);
+  REQUIRE(report.failures.size() == 2);
+  for (auto const& failure : report.failures) {
+    CHECK(failure.requirement.foreground == 0x0D);
+    CHECK(failure.ratio < failure.requirement.min_ratio);
+    CHECK(failure.ratio == report.matrix(0x0D, failure.requirement.background));
+  }
+}
+
+TEST_CASE("contrast repair shifts lightness of failing foregrounds only") {
+  auto theme = make_theme();
+  auto const requirements = walng::get_default_contrast_requirements(theme.palette.size());
+  auto const original = theme.palette;
+
+  theme.palette[0x05] = walng::color{0x404040u};
+  theme.palette[0x0D] = walng::color{0x203a60u};
+  auto const broken = theme.palette;
+
+  auto const adjustments = walng::repair_contrast(theme, requirements);
+  REQUIRE(adjustments.size() == 2);
+  CHECK(adjustments[0].index == 0x05);
+  CHECK(adjustments[0].before == broken[0x05]);
+  CHECK(adjustments[0].after == theme.palette[0x05]);
+  CHECK(adjustments[1].index == 0x0D);
+
+  CHECK(walng::check_contrast(theme, requirements).failures.empty());
+
+  // other colors, backgrounds included, are kept
+  for (std::size_t index = 0; index < theme.palette.size(); ++index) {
+    if (index != 0x05 && index != 0x0D) {
+      CHECK(theme.palette[index] == original[index]);
+    }
+  }
+
+  // hue is kept and the smallest passing shift is taken (lighter on dark background)
+  auto const before = broken[0x0D].as_oklch();
+  auto const after = theme.palette[0x0D].as_oklch();
+  CHECK(after.l > before.l);
+  CHECK(std::abs(after.h - before.h) < 0.1f);
+  walng::contrast_matrix const matrix(theme.palette);
+  CHECK(std::min(matrix(0x0D, 0x00), matrix(0x0D, 0x01)) < 3.1f);
+
+  // repaired theme needs no changes
+  CHECK(walng::repair_contrast(theme, requirements).empty());
+}
+
+TEST_CASE("contrast repair leaves unreachable requirements") {
+  auto theme = make_theme();
+  std::vector<walng::contrast_requirement> const requirements = {{0x08, 0x00, 22.0f}};
+  auto const before = theme.palette[0x08];
+  CHECK(walng::repair_contrast(theme, requirements).empty());
+  CHECK(theme.palette[0x08] == before);
+}
@@ -0,0 +1,207 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <span>
+#include <vector>
+
+import walng.color;
+import walng.parallel;
+
+module walng.palette_index;
+
+namespace walng {
+namespace {
+
+/// Palettes per kernel chunk, accumulators stay in registers / L1
+constexpr std::size_t chunk_size = 64;
+
+/// Palettes per tile side in pairwise scans, one tile of planes (48 x 256 floats) stays in L2
+constexpr std::size_t tile_size = 256;
+
+auto unpack_palette(packed_palettes const& palettes, std::size_t index) noexcept -> packed_palette {
+  packed_palette result;
+  for (std::size_t coordinate = 0; coordinate < palette_stride; ++coordinate) {
+    result[coordinate] = palettes.plane(coordinate)[index];
+  }
+  return result;
+}
+
+auto find_root(std::vector<std::size_t>& parents, std::size_t index) noexcept -> std::size_t {
+  while (parents[index] != index) {
+    parents[index] = parents[parents[index]];
+    index = parents[index];
+  }
+  return index;
+}
+
+} // namespace
+
+auto pack_palette(std::span<color const> palette) noexcept -> packed_palette {
+  packed_palette result = {};
+  auto const count = std::min(palette.size(), palette_slots);
+  for (std::size_t slot = 0; slot < count; ++slot) {
+    auto const lab = palette[slot].as_oklab();
+    result[slot * 3 + 0] = lab.l;
+    result[slot * 3 + 1] = lab.a;
+    result[slot * 3 + 2] = lab.b;
+  }
+  return result;
+}
+
+packed_palettes::packed_palettes(std::span<packed_palette const> palettes)
+    : size_(palettes.size()), planes_(palette_stride * palettes.size()) {
+  for (std::size_t index = 0; index < size_; ++index) {
+    for (std::size_t coordinate = 0; coordinate < palette_stride; ++coordinate) {
+      planes_[coordinate * size_ + index] = palettes[index][coordinate];
+    }
+  }
+}
+
+auto palette_distance_sq(packed_palette const& lhs, packed_palette const& rhs, std::size_t slot_count) noexcept
+    -> float {
+  float result = 0.0f;
+  for (std::size_t i = 0; i < slot_count * 3; ++i) {
+    auto const delta = lhs[i] - rhs[i];
+    result += delta * delta;
+  }
+  return result / static_cast<float>(slot_count);
+}
+
+void palette_distances_sq(packed_palettes const& palettes, packed_palette const& query, std::size_t first,
+    std::span<float> out, std::size_t slot_count) noexcept {
+  auto const scale = 1.0f / static_cast<float>(slot_count);
+
+  for (std::size_t chunk_first = 0; chunk_first < out.size(); chunk_first += chunk_size) {
+    auto const count = std::min(chunk_size, out.size() - chunk_first);
+    auto const offset = first + chunk_first;
+
+    std::array<float, chunk_size> acc = {};
+    for (std::size_t coordinate = 0; coordinate < slot_count * 3; ++coordinate) {
+      float const* const values = palettes.plane(coordinate) + offset;
+      float const q = query[coordinate];
+      // inner loop over palettes is contiguous and branch free, compilers turn it into packed SIMD
+      for (std::size_t i = 0; i < count; ++i) {
+        auto const delta = values[i] - q;
+        acc[i] += delta * delta;
+      }
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+      out[chunk_first + i] = acc[i] * scale;
+    }
+  }
+}
+
+auto find_nearest_palettes(packed_palettes const& palettes, packed_palette const& query, std::size_t k,
+    std::size_t slot_count) -> std::vector<palette_match> {
+  std::vector<float> distances(palettes.size());
+  palette_distances_sq(palettes, query, 0, distances, slot_count);
+
+  std::vector<palette_match> result;
+  result.reserve(distances.size());
+  for (std::size_t index = 0; index < distances.size(); ++index) {
+    result.push_back(palette_match{index, distances[index]});
+  }
+
+  auto const ordering = [](palette_match const& lhs, palette_match const& rhs) {
+    return lhs.distance < rhs.distance || (lhs.distance == rhs.distance && lhs.index < rhs.index);
+  };
+  k = std::min(k, result.size());
+  std::ranges::partial_sort(result, result.begin() + static_cast<std::ptrdiff_t>(k), ordering);
+  result.resize(k);
+
+  for (auto& match : result) {
+    match.distance = std::sqrt(match.distance);
+  }
+  return result;
+}
+
+auto find_close_palette_pairs(packed_palettes const& palettes, float threshold) -> std::vector<palette_pair> {
+  auto const tile_count = (palettes.size() + tile_size - 1) / tile_size;
+  auto const threshold_sq = threshold * threshold;
+
+  // one result bucket per row of tiles, no synchronization between workers
+  std::vector<std::vector<palette_pair>> buckets(tile_count);
+
+  parallel_for(tile_count, [&](std::size_t row_tile) {
+    auto const row_first = row_tile * tile_size;
+    auto const row_last = std::min(row_first + tile_size, palettes.size());
+
+    std::vector<packed_palette> rows;
+    rows.reserve(row_last - row_first);
+    for (auto index = row_first; index < row_last; ++index) {
+      rows.push_back(unpack_palette(palettes, index));
+    }
+
+    std::array<float, tile_size> distances;
+    auto& bucket = buckets[row_tile];
+
+    for (auto column_tile = row_tile; column_tile < tile_count; ++column_tile) {
+      auto const column_first = column_tile * tile_size;
+      auto const column_last = std::min(column_first + tile_size, palettes.size());
+
+      for (auto index = row_first; index < row_last; ++index) {
+        // diagonal tile: only pairs above diagonal
+        auto const first = std::max(column_first, index + 1);
+        if (first >= column_last) {
+          continue;
+        }
+        auto const out = std::span(distances).first(column_last - first);
+        palette_distances_sq(palettes, rows[index - row_first], first, out);
+        for (std::size_t i = 0; i < out.size(); ++i) {
+          if (out[i] <= threshold_sq) {
+            bucket.push_back(palette_pair{static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(first + i),
+                std::sqrt(out[i])});
+          }
+        }
+      }
+    }
+  });
+
+  std::vector<palette_pair> result;
+  for (auto const& bucket : buckets) {
+    result.insert(result.end(), bucket.begin(), bucket.end());
+  }
+  return result;
+}
+
+auto cluster_palette_pairs(std::size_t count, std::span<palette_pair const> pairs)
+    -> std::vector<std::vector<std::size_t>> {
+  std::vector<std::size_t> parents(count);
+  std::iota(parents.begin(), parents.end(), std::size_t{0});
+
+  for (auto const& pair : pairs) {
+    auto const lhs = find_root(parents, pair.lhs);
+    auto const rhs = find_root(parents, pair.rhs);
+    if (lhs != rhs) {
+      parents[std::max(lhs, rhs)] = std::min(lhs, rhs);
+    }
+  }
+
+  // roots are the smallest members, so clusters come out ordered by first member
+  std::vector<std::size_t> cluster_ids(count, count);
+  std::vector<std::vector<std::size_t>> clusters;
+  for (std::size_t index = 0; index < count; ++index) {
+    auto const root = find_root(parents, index);
+    if (cluster_ids[root] == count) {
+      cluster_ids[root] = clusters.size();
+      clusters.emplace_back();
+    }
+    clusters[cluster_ids[root]].push_back(index);
+  }
+
+  std::erase_if(clusters, [](std::vector<std::size_t> const& cluster) {
+    return cluster.size() < 2;
+  });
+  return clusters;
+}
+
+} // namespace walng
@@ -0,0 +1,91 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+import walng.color;
+
+export module walng.palette_index;
+
+namespace walng {
+
+/// Number of compared palette slots (base00..base0F, shared by base16 and base24)
+export constexpr std::size_t palette_slots = 16;
+
+/// Floats per packed palette (OKLab triple per slot)
+export constexpr std::size_t palette_stride = palette_slots * 3;
+
+/// Palette as OKLab coordinates, [slot * 3 + (L, a, b)]
+export using packed_palette = std::array<float, palette_stride>;
+
+/// Pack first palette_slots colors, missing slots are zero
+export [[nodiscard]] auto pack_palette(std::span<color const> palette) noexcept -> packed_palette;
+
+/// Many palettes in structure-of-arrays layout
+/// Every palette coordinate is stored in its own contiguous plane so distance kernels process many palettes per
+/// instruction
+export class packed_palettes {
+private:
+  std::size_t size_ = 0;
+  std::vector<float> planes_;
+
+public:
+  packed_palettes() = default;
+
+  explicit packed_palettes(std::span<packed_palette const> palettes);
+
+  auto size() const noexcept -> std::size_t {
+    return size_;
+  }
+
+  /// Coordinate plane, palette_stride planes of size() values
+  auto plane(std::size_t coordinate) const noexcept -> float const* {
+    return planes_.data() + coordinate * size_;
+  }
+};
+
+/// Palette distance is RMS of per slot OKLab distances over first slot_count slots
+/// Kernels return squared distances (monotonic, cheaper); take sqrt for reporting
+export [[nodiscard]] auto palette_distance_sq(
+    packed_palette const& lhs, packed_palette const& rhs, std::size_t slot_count = palette_slots) noexcept -> float;
+
+/// Squared distances from query to palettes [first, first + out.size())
+export void palette_distances_sq(packed_palettes const& palettes, packed_palette const& query, std::size_t first,
+    std::span<float> out, std::size_t slot_count = palette_slots) noexcept;
+
+/// Nearest palette search result
+export struct palette_match {
+  /// Index of palette
+  std::size_t index;
+  /// RMS OKLab distance
+  float distance;
+};
+
+/// k nearest palettes to query, ordered by distance
+export [[nodiscard]] auto find_nearest_palettes(packed_palettes const& palettes, packed_palette const& query,
+    std::size_t k, std::size_t slot_count = palette_slots) -> std::vector<palette_match>;
+
+/// Pair of close palettes
+export struct palette_pair {
+  std::uint32_t lhs;
+  std::uint32_t rhs;
+  /// RMS OKLab distance
+  float distance;
+};
+
+/// All pairs of palettes closer than threshold
+/// Upper triangle of distance matrix is computed in cache sized tiles spread over worker threads
+export [[nodiscard]] auto find_close_palette_pairs(packed_palettes const& palettes, float threshold)
+    -> std::vector<palette_pair>;
+
+/// Connected groups (single linkage) of palettes from pairs, only groups of two or more, ordered by first member
+export [[nodiscard]] auto cluster_palette_pairs(std::size_t count, std::span<palette_pair const> pairs)
+    -> std::vector<std::vector<std::size_t>>;
+
+} // namespace walng
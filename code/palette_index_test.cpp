@@ -0,0 +1,142 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+import walng.color;
+import walng.palette_index;
+
+namespace {
+
+auto make_palettes(std::size_t count, std::uint32_t seed) -> std::vector<walng::packed_palette> {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<std::uint32_t> channel(0, 0xffffff);
+  std::vector<walng::packed_palette> result;
+  for (std::size_t index = 0; index < count; ++index) {
+    std::vector<walng::color> palette;
+    for (std::size_t slot = 0; slot < walng::palette_slots; ++slot) {
+      palette.push_back(walng::color{channel(rng)});
+    }
+    result.push_back(walng::pack_palette(palette));
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("OKLab coordinates of reference colors") {
+  auto const white = walng::color{0xffffffu}.as_oklab();
+  CHECK(white.l == doctest::Approx(1.0f).epsilon(1e-3));
+  CHECK(white.a == doctest::Approx(0.0f).epsilon(1e-3));
+  CHECK(white.b == doctest::Approx(0.0f).epsilon(1e-3));
+
+  auto const black = walng::color{0x000000u}.as_oklab();
+  CHECK(black.l == doctest::Approx(0.0f).epsilon(1e-3));
+
+  // https://bottosson.github.io/posts/oklab/ sRGB red
+  auto const red = walng::color{0xff0000u}.as_oklab();
+  CHECK(red.l == doctest::Approx(0.628f).epsilon(1e-2));
+  CHECK(red.a == doctest::Approx(0.225f).epsilon(1e-2));
+  CHECK(red.b == doctest::Approx(0.126f).epsilon(1e-2));
+
+  for (std::uint32_t value : {0x000000u, 0x102030u, 0x7f7f7fu, 0xff8000u, 0xffffffu}) {
+    CHECK(walng::color::from_oklab(walng::color{value}.as_oklab()) == walng::color{value});
+  }
+}
+
+TEST_CASE("palette distance kernel matches scalar distance") {
+  // more palettes than one chunk and one tile, with partial tails
+  auto const palettes = make_palettes(600, 1);
+  walng::packed_palettes const packed(palettes);
+  REQUIRE(packed.size() == palettes.size());
+
+  auto const& query = palettes[17];
+  for (std::size_t const slot_count : {std::size_t{8}, walng::palette_slots}) {
+    std::vector<float> distances(palettes.size() - 5);
+    walng::palette_distances_sq(packed, query, 5, distances, slot_count);
+    for (std::size_t i = 0; i < distances.size(); ++i) {
+      CHECK(distances[i] == doctest::Approx(walng::palette_distance_sq(palettes[5 + i], query, slot_count)));
+    }
+  }
+
+  CHECK(walng::palette_distance_sq(query, query) == 0.0f);
+  walng::packed_palette const zero = {};
+  auto shifted = zero;
+  for (std::size_t slot = 0; slot < walng::palette_slots; ++slot) {
+    shifted[slot * 3] = 0.5f;
+  }
+  // RMS of equal per slot distances is that distance
+  CHECK(std::sqrt(walng::palette_distance_sq(zero, shifted)) == doctest::Approx(0.5f));
+}
+
+TEST_CASE("nearest palettes are ordered by distance") {
+  auto const palettes = make_palettes(300, 2);
+  walng::packed_palettes const packed(palettes);
+
+  auto const matches = walng::find_nearest_palettes(packed, palettes[42], 10);
+  REQUIRE(matches.size() == 10);
+  CHECK(matches[0].index == 42);
+  CHECK(matches[0].distance == 0.0f);
+  for (std::size_t i = 1; i < matches.size(); ++i) {
+    CHECK(matches[i - 1].distance <= matches[i].distance);
+    CHECK(matches[i].distance ==
+          doctest::Approx(std::sqrt(walng::palette_distance_sq(palettes[matches[i].index], palettes[42]))));
+  }
+
+  CHECK(walng::find_nearest_palettes(packed, palettes[0], 1000).size() == palettes.size());
+}
+
+TEST_CASE("close palette pairs match brute force") {
+  // near copies of a few palettes spread over several tiles
+  auto palettes = make_palettes(700, 3);
+  for (std::size_t const index : {10u, 300u, 650u}) {
+    palettes[index] = palettes[5];
+    palettes[index][0] += 0.001f;
+  }
+  palettes[699] = palettes[400];
+
+  walng::packed_palettes const packed(palettes);
+  float const threshold = 0.05f;
+  auto const pairs = walng::find_close_palette_pairs(packed, threshold);
+
+  std::set<std::tuple<std::uint32_t, std::uint32_t>> found;
+  for (auto const& pair : pairs) {
+    CHECK(pair.lhs < pair.rhs);
+    CHECK(pair.distance <= threshold);
+    found.emplace(pair.lhs, pair.rhs);
+  }
+  CHECK(found.size() == pairs.size());
+
+  std::set<std::tuple<std::uint32_t, std::uint32_t>> expected;
+  for (std::uint32_t lhs = 0; lhs < palettes.size(); ++lhs) {
+    for (std::uint32_t rhs = lhs + 1; rhs < palettes.size(); ++rhs) {
+      if (walng::palette_distance_sq(palettes[lhs], palettes[rhs]) <= threshold * threshold) {
+        expected.emplace(lhs, rhs);
+      }
+    }
+  }
+  CHECK(found == expected);
+
+  auto const clusters = walng::cluster_palette_pairs(palettes.size(), pairs);
+  REQUIRE(clusters.size() == 2);
+  CHECK(clusters[0] == std::vector<std::size_t>{5, 10, 300, 650});
+  CHECK(clusters[1] == std::vector<std::size_t>{400, 699});
+}
+
+TEST_CASE("palette clusters are connected through chains of pairs") {
+  std::vector<walng::palette_pair> const pairs = {{3, 4, 0.0f}, {1, 4, 0.0f}, {6, 7, 0.0f}, {0, 6, 0.0f}};
+  auto const clusters = walng::cluster_palette_pairs(9, pairs);
+  REQUIRE(clusters.size() == 2);
+  CHECK(clusters[0] == std::vector<std::size_t>{0, 6, 7});
+  CHECK(clusters[1] == std::vector<std::size_t>{1, 3, 4});
+
+  CHECK(walng::cluster_palette_pairs(4, {}).empty());
+}
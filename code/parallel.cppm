@@ -0,0 +1,131 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+export module walng.parallel;
+
+namespace walng {
+
+/// Number of worker threads for parallel jobs
+export [[nodiscard]] auto get_worker_count() noexcept -> std::size_t {
+  return std::max<std::size_t>(1, std::thread::hardware_concurrency());
+}
+
+/// Invoke fn(index) for every index in [0, count) on worker threads
+/// Indexes are handed out one by one, so uneven jobs balance themselves; first exception is rethrown
+export template <typename Fn>
+void parallel_for(std::size_t count, Fn&& fn) {
+  auto const worker_count = std::min(get_worker_count(), count);
+  if (worker_count <= 1) {
+    for (std::size_t index = 0; index < count; ++index) {
+      fn(index);
+    }
+    return;
+  }
+
+  std::atomic<std::size_t> next_index = 0;
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto const worker = [&] {
+    for (;;) {
+      auto const index = next_index.fetch_add(1, std::memory_order_relaxed);
+      if (index >= count) {
+        break;
+      }
+      try {
+        fn(index);
+      } catch (...) {
+        std::scoped_lock lock(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next_index.store(count, std::memory_order_relaxed);
+      }
+    }
+  };
+
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(worker_count - 1);
+    for (std::size_t i = 1; i < worker_count; ++i) {
+      workers.emplace_back(worker);
+    }
+    worker();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+/// Multi-producer multi-consumer FIFO queue with limited capacity
+/// push() blocks while queue is full, so fast producers can't outrun consumers and hold unbounded memory
+export template <typename T>
+class bounded_queue {
+private:
+  std::size_t capacity_;
+  std::deque<T> items_;
+  bool closed_ = false;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+
+public:
+  explicit bounded_queue(std::size_t capacity) : capacity_(std::max<std::size_t>(1, capacity)) {}
+
+  bounded_queue(bounded_queue const&) = delete;
+  bounded_queue& operator=(bounded_queue const&) = delete;
+
+  /// Enqueue item, returns false if queue is closed
+  auto push(T item) -> bool {
+    std::unique_lock lock(mutex_);
+    not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /// Dequeue item, returns std::nullopt once queue is closed and drained
+  auto pop() -> std::optional<T> {
+    std::unique_lock lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return std::nullopt;
+    }
+    auto result = std::optional<T>(std::move(items_.front()));
+    items_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return result;
+  }
+
+  /// Reject further pushes and wake up all waiters, queued items are still delivered
+  auto close() -> void {
+    {
+      std::scoped_lock lock(mutex_);
+      closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+};
+
+} // namespace walng
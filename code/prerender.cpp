@@ -0,0 +1,203 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+import walng.basexx_theme;
+import walng.binary_io;
+import walng.builtin_templates;
+import walng.config;
+import walng.hash;
+import walng.render_cache;
+import walng.store;
+import walng.utils;
+import walng.version;
+
+module walng.prerender;
+
+namespace walng {
+namespace {
+
+constexpr std::uint64_t prerender_set_magic = 0x33455250474e4c57ull; // "WLNGPRE3"
+
+/// Sets of theme are kept in directory of theme, there is only one set per theme after save
+auto get_prerender_theme_path(std::filesystem::path const& prerender_path, std::uint64_t theme_hash)
+    -> std::filesystem::path {
+  return prerender_path / "sets" / hash_to_hex_str(theme_hash).string();
+}
+
+auto get_prerender_set_file_path(std::filesystem::path const& prerender_path, prerender_set_key key)
+    -> std::filesystem::path {
+  auto const name = std::format("{}.bin", hash_to_hex_str(key.value).string());
+  return get_prerender_theme_path(prerender_path, key.theme) / name;
+}
+
+auto parse_prerender_set(std::string_view content, std::optional<std::uint64_t> key)
+    -> std::expected<prerender_set, std::string> {
+  binary_reader reader(content);
+
+  std::uint64_t magic;
+  std::uint64_t stored_key;
+  std::uint32_t count;
+  if (!reader.read(magic) || magic != prerender_set_magic || !reader.read(stored_key) ||
+      (key && stored_key != *key) || !reader.read(count)) {
+    return std::unexpected("invalid prerendered set");
+  }
+
+  prerender_set result;
+  result.entries.reserve(count);
+  for (std::uint32_t i = 0; i < count; ++i) {
+    auto& entry = result.entries.emplace_back();
+    std::string_view target_path;
+    if (!reader.read_string(entry.name) || !reader.read_string(target_path) || !reader.read(entry.template_hash) ||
+        !reader.read(entry.blob_hash)) {
+      return std::unexpected("invalid prerendered set");
+    }
+    entry.target_path = target_path;
+  }
+
+  return {std::move(result)};
+}
+
+} // namespace
+
+auto get_prerender_path() -> std::expected<std::filesystem::path, std::string> {
+  return get_cache_path().transform([](std::filesystem::path const& path) {
+    return path / "prerender";
+  });
+}
+
+auto get_prerender_set_key(config const& config, basexx_theme const& theme) -> prerender_set_key {
+  hasher theme_hasher;
+  hash_theme(theme_hasher, theme);
+  auto const theme_hash = theme_hasher.digest();
+
+  hasher result;
+  result.update(std::string_view(version)).update(theme_hash);
+  for (auto const& item : config.items) {
+    result.update(item.name).update(item.template_path.native()).update(item.target_path.native()).update(item.engine);
+  }
+  return {theme_hash, result.digest()};
+}
+
+auto load_prerender_set(std::filesystem::path const& prerender_path, prerender_set_key key)
+    -> std::expected<prerender_set, std::string> {
+  auto const content = read_file(get_prerender_set_file_path(prerender_path, key));
+  if (!content) {
+    return std::unexpected(content.error());
+  }
+  return parse_prerender_set(*content, key.value);
+}
+
+auto save_prerender_set(std::filesystem::path const& prerender_path, prerender_set_key key, prerender_set const& set)
+    -> std::expected<void, std::string> {
+  binary_writer writer;
+  writer.write(prerender_set_magic);
+  writer.write(key.value);
+  writer.write(static_cast<std::uint32_t>(set.entries.size()));
+  for (auto const& entry : set.entries) {
+    writer.write_string(entry.name);
+    writer.write_string(entry.target_path.native());
+    writer.write(entry.template_hash);
+    writer.write(entry.blob_hash);
+  }
+  auto const path = get_prerender_set_file_path(prerender_path, key);
+  if (auto const rc = write_file(path, writer.data()); !rc) {
+    return std::unexpected(rc.error());
+  }
+
+  // sets of theme rendered with other config are superseded, their blobs are left to prune_prerender_blobs()
+  std::error_code ec;
+  auto it = std::filesystem::directory_iterator(path.parent_path(), ec);
+  for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+    if (it->path() != path) {
+      std::error_code remove_ec;
+      std::filesystem::remove(it->path(), remove_ec);
+    }
+  }
+  return {};
+}
+
+auto prune_prerender_blobs(std::filesystem::path const& prerender_path, blob_store const& store)
+    -> std::expected<std::size_t, std::string> {
+  std::unordered_set<std::uint64_t> referenced;
+  std::error_code ec;
+  auto it = std::filesystem::recursive_directory_iterator(prerender_path / "sets", ec);
+  for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+    std::error_code entry_ec;
+    if (!it->is_regular_file(entry_ec)) {
+      continue;
+    }
+    auto const content = read_file(it->path());
+    if (!content) {
+      return std::unexpected(std::format("failed to read '{}' ({})", it->path().native(), content.error()));
+    }
+    // set of other format is never loaded, it refers to nothing
+    auto const set = parse_prerender_set(*content, std::nullopt);
+    if (!set) {
+      std::filesystem::remove(it->path(), entry_ec);
+      continue;
+    }
+    for (auto const& entry : set->entries) {
+      referenced.insert(entry.blob_hash);
+    }
+  }
+  if (ec && ec != std::errc::no_such_file_or_directory) {
+    return std::unexpected(std::format("can't scan prerendered sets ({})", ec.message()));
+  }
+
+  std::size_t removed = 0;
+  it = std::filesystem::recursive_directory_iterator(store.root(), ec);
+  for (; !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec)) {
+    std::error_code entry_ec;
+    if (!it->is_regular_file(entry_ec)) {
+      continue;
+    }
+    auto const hash = hash_from_hex_str(it->path().filename().native());
+    if (hash && !referenced.contains(*hash) && std::filesystem::remove(it->path(), entry_ec)) {
+      ++removed;
+    }
+  }
+  return removed;
+}
+
+auto validate_prerender_set(prerender_set const& set, config const& config, blob_store const& store)
+    -> std::expected<void, std::string> {
+  if (set.entries.size() != config.items.size()) {
+    return std::unexpected("config items changed");
+  }
+  for (std::size_t i = 0; i < set.entries.size(); ++i) {
+    auto const& entry = set.entries[i];
+    auto const& item = config.items[i];
+    if (entry.name != item.name || entry.target_path != item.target_path) {
+      return std::unexpected(std::format("item '{}' changed", item.name));
+    }
+    auto const template_hash = hash_template_tree(item.template_path);
+    if (!template_hash) {
+      return std::unexpected(
+          std::format("failed to hash template of item '{}' ({})", item.name, template_hash.error()));
+    }
+    if (*template_hash != entry.template_hash) {
+      return std::unexpected(std::format("template of item '{}' changed", item.name));
+    }
+    if (!store.contains(entry.blob_hash)) {
+      return std::unexpected(std::format("rendered content of item '{}' is missing", item.name));
+    }
+  }
+  return {};
+}
+
+} // namespace walng
@@ -0,0 +1,68 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+import walng.basexx_theme;
+import walng.config;
+import walng.store;
+
+export module walng.prerender;
+
+namespace walng {
+
+/// Prerendered config item
+export struct prerender_entry {
+  /// Config item name
+  std::string name;
+  /// Config item target path
+  std::filesystem::path target_path;
+  /// Hash of template used for rendering and templates it includes
+  std::uint64_t template_hash;
+  /// Hash of rendered content (blob name)
+  std::uint64_t blob_hash;
+};
+
+/// Prerendered outputs of all config items for one theme
+export struct prerender_set {
+  std::vector<prerender_entry> entries;
+};
+
+/// Prerendered sets and blobs location, $XDG_CACHE_HOME/walng/prerender
+export [[nodiscard]] auto get_prerender_path() -> std::expected<std::filesystem::path, std::string>;
+
+/// Key of prerendered set
+export struct prerender_set_key {
+  /// Hash of theme content, sets of one theme supersede each other
+  std::uint64_t theme;
+  /// Hash of theme content, config items and walng version
+  std::uint64_t value;
+};
+
+export [[nodiscard]] auto get_prerender_set_key(config const& config, basexx_theme const& theme)
+    -> prerender_set_key;
+
+export [[nodiscard]] auto load_prerender_set(std::filesystem::path const& prerender_path, prerender_set_key key)
+    -> std::expected<prerender_set, std::string>;
+
+/// Save set of theme, sets of the theme saved before (other config) are removed
+export [[nodiscard]] auto save_prerender_set(std::filesystem::path const& prerender_path, prerender_set_key key,
+    prerender_set const& set) -> std::expected<void, std::string>;
+
+/// Remove blobs no saved set refers to, returns number of removed blobs
+/// Blobs are stored before their set is saved, so it must not run while sets are prerendered.
+export [[nodiscard]] auto prune_prerender_blobs(std::filesystem::path const& prerender_path, blob_store const& store)
+    -> std::expected<std::size_t, std::string>;
+
+/// Check prerendered set against config: same items, unchanged templates (includes too) and all blobs present
+export [[nodiscard]] auto validate_prerender_set(prerender_set const& set, config const& config,
+    blob_store const& store) -> std::expected<void, std::string>;
+
+} // namespace walng
@@ -0,0 +1,91 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <filesystem>
+#include <string_view>
+
+#include <doctest/doctest.h>
+
+import walng.basexx_theme;
+import walng.config;
+import walng.prerender;
+import walng.render_cache;
+import walng.store;
+import walng.utils;
+
+TEST_CASE("prerendered set is invalidated by included template change") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-prerender-test-" + walng::make_random_name());
+  std::filesystem::create_directories(root);
+
+  REQUIRE(walng::write_file(root / "partial.tmpl", "colors"));
+  REQUIRE(walng::write_file(root / "main.tmpl", "{% include \"partial.tmpl\" %}"));
+
+  walng::config config;
+  config.items.push_back({"item", root / "main.tmpl", root / "output", {}, walng::template_engine::inja});
+
+  walng::blob_store const store(root / "blobs");
+  auto const blob_hash = store.put("colors");
+  REQUIRE(blob_hash);
+  auto const template_hash = walng::hash_template_tree(root / "main.tmpl");
+  REQUIRE(template_hash);
+
+  walng::prerender_set set;
+  set.entries.push_back({"item", root / "output", *template_hash, *blob_hash});
+  walng::prerender_set_key const key{1, 2};
+  REQUIRE(walng::save_prerender_set(root, key, set));
+  auto const loaded = walng::load_prerender_set(root, key);
+  REQUIRE(loaded);
+  CHECK(walng::validate_prerender_set(*loaded, config, store));
+
+  REQUIRE(walng::write_file(root / "partial.tmpl", "palette"));
+  CHECK_FALSE(walng::validate_prerender_set(*loaded, config, store));
+
+  std::filesystem::remove(root / "partial.tmpl");
+  CHECK_FALSE(walng::validate_prerender_set(*loaded, config, store));
+
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("prerendered set supersedes sets of theme and prune keeps its blobs") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-prerender-test-" + walng::make_random_name());
+  std::filesystem::create_directories(root);
+  walng::blob_store const store(root / "blobs");
+
+  auto const make_set = [&](std::string_view content) {
+    walng::prerender_set set;
+    set.entries.push_back({"item", root / "output", 0, store.put(content).value()});
+    return set;
+  };
+
+  // key of theme changes with config
+  walng::config config;
+  walng::basexx_theme theme;
+  theme.name = "test";
+  auto const first_key = walng::get_prerender_set_key(config, theme);
+  config.items.push_back({"item", root / "main.tmpl", root / "output", {}, walng::template_engine::inja});
+  auto const second_key = walng::get_prerender_set_key(config, theme);
+  CHECK(first_key.theme == second_key.theme);
+  CHECK(first_key.value != second_key.value);
+  theme.name = "other";
+  auto const other_key = walng::get_prerender_set_key(config, theme);
+  CHECK(other_key.theme != first_key.theme);
+
+  auto const first = make_set("first");
+  auto const second = make_set("second");
+  auto const other = make_set("other");
+  REQUIRE(walng::save_prerender_set(root, first_key, first));
+  REQUIRE(walng::save_prerender_set(root, other_key, other));
+  REQUIRE(walng::save_prerender_set(root, second_key, second));
+  CHECK_FALSE(walng::load_prerender_set(root, first_key));
+  CHECK(walng::load_prerender_set(root, second_key));
+  CHECK(walng::load_prerender_set(root, other_key));
+
+  auto const removed = walng::prune_prerender_blobs(root, store);
+  REQUIRE(removed);
+  CHECK(*removed == 1);
+  CHECK_FALSE(store.contains(first.entries[0].blob_hash));
+  CHECK(store.contains(second.entries[0].blob_hash));
+  CHECK(store.contains(other.entries[0].blob_hash));
+
+  std::filesystem::remove_all(root);
+}
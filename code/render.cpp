@@ -0,0 +1,429 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <functional>
+#include <ranges>
+#include <set>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <inja/inja.hpp>
+
+import walng.basexx_theme;
+import walng.color;
+import walng.include_cache;
+
+module walng.render;
+
+namespace walng {
+namespace {
+
+/// Collects theme data referenced by template AST
+class theme_usage_visitor : public inja::NodeVisitor {
+private:
+  theme_usage& usage_;
+  /// Names introduced by loops and set statements, they shadow theme data
+  std::set<std::string, std::less<>> locals_;
+  /// Analyzed include / extends files
+  std::set<std::string>& visited_files_;
+  /// Environment parsing included files, with include cache attached
+  inja::Environment& env_;
+  include_cache& includes_;
+
+public:
+  theme_usage_visitor(
+      theme_usage& usage, std::set<std::string>& visited_files, inja::Environment& env, include_cache& includes)
+      : usage_(usage), visited_files_(visited_files), env_(env), includes_(includes) {}
+
+  void visit(inja::BlockNode const& node) override {
+    for (auto const& child : node.nodes) {
+      child->accept(*this);
+    }
+  }
+
+  void visit(inja::TextNode const&) override {}
+  void visit(inja::ExpressionNode const&) override {}
+  void visit(inja::LiteralNode const&) override {}
+
+  void visit(inja::DataNode const& node) override {
+    std::string_view name = node.name;
+    auto const dot = name.find('.');
+    auto const root = name.substr(0, dot);
+    auto const rest = dot == name.npos ? std::string_view() : name.substr(dot + 1);
+    auto const key = rest.substr(0, rest.find('.'));
+    if (locals_.contains(root)) {
+      return;
+    }
+
+    if (root == "palette") {
+      if (key.empty()) {
+        usage_.palette = theme_usage_all.palette;
+        return;
+      }
+      for (std::size_t index = 0; index < 24; ++index) {
+        if (basexx_theme_color_name(index) == key) {
+          usage_.palette |= 1u << index;
+        }
+      }
+    } else if (root == "name") {
+      usage_.fields |= theme_field_name;
+    } else if (root == "author") {
+      usage_.fields |= theme_field_author;
+    } else if (root == "variant") {
+      usage_.fields |= theme_field_variant;
+    } else if (root == "system") {
+      usage_.fields |= theme_field_system;
+    }
+  }
+
+  void visit(inja::FunctionNode const& node) override {
+    for (auto const& argument : node.arguments) {
+      argument->accept(*this);
+    }
+  }
+
+  void visit(inja::ExpressionListNode const& node) override {
+    if (node.root) {
+      node.root->accept(*this);
+    }
+  }
+
+  void visit(inja::StatementNode const&) override {}
+  void visit(inja::ForStatementNode const&) override {}
+
+  void visit(inja::ForArrayStatementNode const& node) override {
+    node.condition.accept(*this);
+    auto const saved_locals = locals_;
+    locals_.insert(node.value);
+    node.body.accept(*this);
+    locals_ = saved_locals;
+  }
+
+  void visit(inja::ForObjectStatementNode const& node) override {
+    node.condition.accept(*this);
+    auto const saved_locals = locals_;
+    locals_.insert(node.key);
+    locals_.insert(node.value);
+    node.body.accept(*this);
+    locals_ = saved_locals;
+  }
+
+  void visit(inja::IfStatementNode const& node) override {
+    node.condition.accept(*this);
+    node.true_statement.accept(*this);
+    node.false_statement.accept(*this);
+  }
+
+  void visit(inja::IncludeStatementNode const& node) override {
+    visit_file(node.file);
+  }
+
+  void visit(inja::ExtendsStatementNode const& node) override {
+    visit_file(node.file);
+  }
+
+  void visit(inja::BlockStatementNode const& node) override {
+    node.block.accept(*this);
+  }
+
+  void visit(inja::SetStatementNode const& node) override {
+    node.expression.accept(*this);
+    locals_.insert(node.key);
+  }
+
+private:
+  /// Included templates are parsed once per analysis, unreadable ones are assumed to use everything
+  void visit_file(std::string const& file) {
+    if (!visited_files_.insert(file).second) {
+      return;
+    }
+    try {
+      auto const tmpl = includes_.load(file, [this, &file] {
+        return env_.parse_template(file);
+      });
+      theme_usage_visitor visitor(usage_, visited_files_, env_, includes_);
+      tmpl.root.accept(visitor);
+    } catch (std::exception const&) {
+      usage_ |= theme_usage_all;
+    }
+  }
+};
+
+/// Color from first callback argument ("#rrggbb")
+auto get_color_argument(inja::Arguments const& args) -> color {
+  auto color_result = parse_color_from_hex_str(args.at(0)->get<std::string>());
+  if (!color_result) {
+    throw std::runtime_error(std::string(color_result.error()));
+  }
+  return *color_result;
+}
+
+auto hex_callback(inja::Arguments& args) -> inja::json {
+  return std::string(get_color_argument(args).as_hex_str().string());
+}
+
+auto rgb_callback(inja::Arguments& args) -> inja::json {
+  auto const rgb = get_color_argument(args).as_rgb();
+  return std::format("{}, {}, {}", rgb.r, rgb.g, rgb.b);
+}
+
+auto r_callback(inja::Arguments& args) -> inja::json {
+  return std::format("{}", get_color_argument(args).as_rgb().r);
+}
+
+auto g_callback(inja::Arguments& args) -> inja::json {
+  return std::format("{}", get_color_argument(args).as_rgb().g);
+}
+
+auto b_callback(inja::Arguments& args) -> inja::json {
+  return std::format("{}", get_color_argument(args).as_rgb().b);
+}
+
+/// Color with alpha channel ("#rrggbbaa"), alpha is [0..1]
+auto alpha_callback(inja::Arguments& args) -> inja::json {
+  auto const color = get_color_argument(args);
+  auto const value = std::clamp(args.at(1)->get<double>(), 0.0, 1.0);
+  return std::format("#{}{:02x}", color.as_hex_str().string(), static_cast<unsigned>(std::lround(value * 255.0)));
+}
+
+/// CSS rgba() of "#rrggbb" or "#rrggbbaa" color
+auto rgba_callback(inja::Arguments& args) -> inja::json {
+  auto const str = args.at(0)->get<std::string>();
+  auto const has_alpha = str.size() == 9;
+  auto const color_result = parse_color_from_hex_str(has_alpha ? std::string_view(str).substr(0, 7) : str);
+  if (!color_result) {
+    throw std::runtime_error(std::string(color_result.error()));
+  }
+  double alpha = 1.0;
+  if (has_alpha) {
+    auto const alpha_result = parse_color_from_stripped_hex_str(std::format("0000{}", std::string_view(str).substr(7)));
+    if (!alpha_result) {
+      throw std::runtime_error(std::string(alpha_result.error()));
+    }
+    alpha = std::round(alpha_result->value / 255.0 * 100.0) / 100.0;
+  }
+  auto const rgb = color_result->as_rgb();
+  return std::format("rgba({}, {}, {}, {})", rgb.r, rgb.g, rgb.b, alpha);
+}
+
+} // namespace
+
+auto get_template_callbacks() -> std::span<template_callback const> {
+  static std::vector<template_callback> const callbacks = {
+      {"hex", 1, hex_callback},
+      {"rgb", 1, rgb_callback},
+      {"r", 1, r_callback},
+      {"g", 1, g_callback},
+      {"b", 1, b_callback},
+      {"alpha", 2, alpha_callback},
+      {"rgba", 1, rgba_callback},
+  };
+  return callbacks;
+}
+
+auto is_template_value_truthy(inja::json const& value) -> bool {
+  if (value.is_boolean()) {
+    return value.get<bool>();
+  } else if (value.is_number()) {
+    return value != 0;
+  } else if (value.is_null()) {
+    return false;
+  }
+  return !value.empty();
+}
+
+auto append_template_value(std::string& output, inja::json const& value) -> void {
+  if (value.is_string()) {
+    output.append(value.get_ref<inja::json::string_t const&>());
+  } else if (value.is_number_unsigned()) {
+    output.append(std::to_string(value.get<inja::json::number_unsigned_t>()));
+  } else if (value.is_number_integer()) {
+    output.append(std::to_string(value.get<inja::json::number_integer_t>()));
+  } else if (!value.is_null()) {
+    output.append(value.dump());
+  }
+}
+
+auto get_palette_slot_name(std::size_t index) -> inja::json const& {
+  static auto const names = [] {
+    std::array<inja::json, 24> result;
+    for (std::size_t i = 0; i < result.size(); ++i) {
+      result[i] = std::string(basexx_theme_color_name(i));
+    }
+    return result;
+  }();
+  return names[index];
+}
+
+auto callback_memo::key_hash::operator()(key const& value) const noexcept -> std::size_t {
+  auto result = std::hash<void const*>()(value.callback);
+  for (auto const& argument : value.arguments) {
+    result = result * 31 + std::hash<inja::json>()(argument);
+  }
+  return result;
+}
+
+auto callback_memo::key_hash::operator()(key_view const& value) const noexcept -> std::size_t {
+  auto result = std::hash<void const*>()(value.callback);
+  for (auto const* argument : value.arguments) {
+    result = result * 31 + std::hash<inja::json>()(*argument);
+  }
+  return result;
+}
+
+auto callback_memo::key_equal::operator()(key const& lhs, key const& rhs) const noexcept -> bool {
+  return lhs.callback == rhs.callback && lhs.arguments == rhs.arguments;
+}
+
+auto callback_memo::key_equal::operator()(key_view const& lhs, key const& rhs) const noexcept -> bool {
+  return lhs.callback == rhs.callback &&
+         std::ranges::equal(lhs.arguments, rhs.arguments, [](inja::json const* argument, inja::json const& value) {
+           return *argument == value;
+         });
+}
+
+auto callback_memo::call(template_callback const& callback, inja::Arguments& arguments) -> inja::json const& {
+  // arguments are copied into the key only when a result is stored
+  if (auto const found = results_.find(key_view{&callback, arguments}); found != results_.end()) {
+    ++hits_;
+    return found->second;
+  }
+  ++misses_;
+  auto result = callback.function(arguments);
+  key value{&callback, {}};
+  value.arguments.reserve(arguments.size());
+  for (auto const* argument : arguments) {
+    value.arguments.push_back(*argument);
+  }
+  return results_.emplace(std::move(value), std::move(result)).first->second;
+}
+
+auto get_inja_env() -> inja::Environment {
+  inja::Environment result;
+
+  result.set_trim_blocks(true);
+  result.set_lstrip_blocks(true);
+
+  for (auto const& callback : get_template_callbacks()) {
+    result.add_callback(std::string(callback.name), callback.argc, callback.function);
+  }
+
+  return result;
+}
+
+auto get_inja_env(callback_memo& memo) -> inja::Environment {
+  inja::Environment result;
+
+  result.set_trim_blocks(true);
+  result.set_lstrip_blocks(true);
+
+  for (auto const& callback : get_template_callbacks()) {
+    result.add_callback(std::string(callback.name), callback.argc, [&memo, &callback](inja::Arguments& arguments) {
+      return memo.call(callback, arguments);
+    });
+  }
+
+  return result;
+}
+
+auto basexx_theme_to_json(basexx_theme const& theme) -> inja::json {
+  auto json = inja::json::object();
+
+  json["name"] = theme.name;
+  json["author"] = theme.author;
+  json["variant"] = theme.variant;
+  json["system"] = theme.system;
+
+  auto json_palette = inja::json::object();
+
+  char color_name[7];
+  for (auto const& [index, color] : theme.palette | std::ranges::views::enumerate) {
+    std::format_to_n(color_name, sizeof(color_name), "base{:02X}", index);
+    json_palette[color_name] = std::string("#").append(color.as_hex_str().string());
+  }
+
+  json["palette"] = json_palette;
+
+  return json;
+}
+
+theme_data_provider::theme_data_provider(basexx_theme const& theme) : data_(basexx_theme_to_json(theme)) {
+  auto const& palette = data_["palette"];
+  palette_size_ = std::min(theme.palette.size(), palette_.size());
+  for (std::size_t index = 0; index < palette_size_; ++index) {
+    palette_[index] = &palette[std::string(basexx_theme_color_name(index))];
+  }
+  fields_ = {&palette, &data_["name"], &data_["author"], &data_["variant"], &data_["system"]};
+}
+
+auto theme_data_provider::resolve(inja::DataNode const& node) const -> inja::json const* {
+  constexpr std::string_view palette_prefix = "palette.base";
+
+  std::string_view const name = node.name;
+  if (name.size() == palette_prefix.size() + 2 && name.starts_with(palette_prefix)) {
+    // slot names are upper case hex: base00..base17
+    auto const digit = [](char ch) -> int {
+      return ch >= '0' && ch <= '9' ? ch - '0' : ch >= 'A' && ch <= 'F' ? ch - 'A' + 10 : -1;
+    };
+    auto const high = digit(name[palette_prefix.size()]);
+    auto const low = digit(name[palette_prefix.size() + 1]);
+    if (high < 0 || low < 0) {
+      return nullptr;
+    }
+    auto const index = static_cast<std::size_t>(high * 16 + low);
+    return index < palette_size_ ? palette_[index] : nullptr;
+  }
+
+  constexpr std::array<std::string_view, 5> field_names = {"palette", "name", "author", "variant", "system"};
+  for (std::size_t index = 0; index < field_names.size(); ++index) {
+    if (name == field_names[index]) {
+      return fields_[index];
+    }
+  }
+  return nullptr;
+}
+
+auto analyze_template(inja::Template const& tmpl, inja::Environment& env, include_cache& includes) -> theme_usage {
+  theme_usage result;
+  std::set<std::string> visited_files;
+  theme_usage_visitor visitor(result, visited_files, env, includes);
+  tmpl.root.accept(visitor);
+  return result;
+}
+
+auto diff_themes(basexx_theme const& lhs, basexx_theme const& rhs) -> theme_usage {
+  theme_usage result;
+  if (lhs.name != rhs.name) {
+    result.fields |= theme_field_name;
+  }
+  if (lhs.author != rhs.author) {
+    result.fields |= theme_field_author;
+  }
+  if (lhs.variant != rhs.variant) {
+    result.fields |= theme_field_variant;
+  }
+  if (lhs.system != rhs.system) {
+    result.fields |= theme_field_system;
+  }
+  auto const slots = std::max(lhs.palette.size(), rhs.palette.size());
+  for (std::size_t index = 0; index < slots && index < 24; ++index) {
+    if (index >= lhs.palette.size() || index >= rhs.palette.size() || lhs.palette[index] != rhs.palette[index]) {
+      result.palette |= 1u << index;
+    }
+  }
+  return result;
+}
+
+} // namespace walng
@@ -0,0 +1,193 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <inja/inja.hpp>
+
+import walng.basexx_theme;
+import walng.include_cache;
+
+export module walng.render;
+
+namespace walng {
+
+/// Template callback
+export struct template_callback {
+  std::string_view name;
+  int argc;
+  inja::CallbackFunction function;
+};
+
+/// Callbacks available to templates (hex, rgb, r, g, b, alpha, rgba)
+export [[nodiscard]] auto get_template_callbacks() -> std::span<template_callback const>;
+
+/// Truthiness of value in template conditions, same rules as inja
+export [[nodiscard]] auto is_template_value_truthy(inja::json const& value) -> bool;
+
+/// Append printed value to output, same rules as inja (without html escaping)
+export auto append_template_value(std::string& output, inja::json const& value) -> void;
+
+/// Key of palette slot ("baseXX") as template value, index < 24
+export [[nodiscard]] auto get_palette_slot_name(std::size_t index) -> inja::json const&;
+
+/// Results of template callbacks keyed on callback and argument values
+/// walng callbacks are pure, so repeated calls with the same colors (loops, includes, items) reuse the first result.
+/// Not thread-safe, use one memo per thread.
+export class callback_memo {
+private:
+  struct key {
+    template_callback const* callback;
+    std::vector<inja::json> arguments;
+  };
+
+  /// Arguments of a call, results are looked up by it without copying arguments
+  struct key_view {
+    template_callback const* callback;
+    std::span<inja::json const* const> arguments;
+  };
+
+  struct key_hash {
+    using is_transparent = void;
+
+    auto operator()(key const& value) const noexcept -> std::size_t;
+    auto operator()(key_view const& value) const noexcept -> std::size_t;
+  };
+
+  struct key_equal {
+    using is_transparent = void;
+
+    auto operator()(key const& lhs, key const& rhs) const noexcept -> bool;
+    auto operator()(key_view const& lhs, key const& rhs) const noexcept -> bool;
+    auto operator()(key const& lhs, key_view const& rhs) const noexcept -> bool {
+      return (*this)(rhs, lhs);
+    }
+  };
+
+  std::unordered_map<key, inja::json, key_hash, key_equal> results_;
+  std::size_t hits_ = 0;
+  std::size_t misses_ = 0;
+
+public:
+  /// Result of callback, computed on first call with these arguments
+  auto call(template_callback const& callback, inja::Arguments& arguments) -> inja::json const&;
+
+  auto hits() const noexcept -> std::size_t {
+    return hits_;
+  }
+
+  auto misses() const noexcept -> std::size_t {
+    return misses_;
+  }
+};
+
+/// Template environment with walng callbacks
+export [[nodiscard]] auto get_inja_env() -> inja::Environment;
+
+/// Template environment with walng callbacks answered from memo, memo must outlive environment
+export [[nodiscard]] auto get_inja_env(callback_memo& memo) -> inja::Environment;
+
+/// Template data of theme
+export [[nodiscard]] auto basexx_theme_to_json(basexx_theme const& theme) -> inja::json;
+
+/// Theme data for renderer with direct access to palette slots and theme fields
+/// `palette.baseXX`, `palette` and theme fields are resolved by index into prebuilt json values instead of json
+/// object lookups; anything else falls back to json data.
+export class theme_data_provider final : public inja::DataProvider {
+private:
+  inja::json data_;
+  std::array<inja::json const*, 24> palette_ = {};
+  std::size_t palette_size_ = 0;
+  /// palette, name, author, variant, system
+  std::array<inja::json const*, 5> fields_ = {};
+  /// Callback results of this theme
+  mutable callback_memo memo_;
+
+public:
+  explicit theme_data_provider(basexx_theme const& theme);
+
+  // resolved values point into data_
+  theme_data_provider(theme_data_provider const&) = delete;
+  theme_data_provider& operator=(theme_data_provider const&) = delete;
+
+  /// Json data of theme, for lookups which are not provided
+  auto data() const noexcept -> inja::json const& {
+    return data_;
+  }
+
+  auto resolve(inja::DataNode const& node) const -> inja::json const* override;
+
+  auto palette_size() const noexcept -> std::size_t {
+    return palette_size_;
+  }
+
+  /// Value of palette slot, index < palette_size()
+  auto slot(std::size_t index) const noexcept -> inja::json const* {
+    return palette_[index];
+  }
+
+  /// Value of field: 0 - palette, 1 - name, 2 - author, 3 - variant, 4 - system
+  auto field(std::size_t index) const noexcept -> inja::json const* {
+    return fields_[index];
+  }
+
+  /// Memo of callback results for renders of this theme
+  auto memo() const noexcept -> callback_memo& {
+    return memo_;
+  }
+};
+
+/// Theme fields besides palette
+export enum theme_field : std::uint32_t {
+  theme_field_name = 1u << 0,
+  theme_field_author = 1u << 1,
+  theme_field_variant = 1u << 2,
+  theme_field_system = 1u << 3,
+};
+
+/// Theme data read by template (or changed between themes)
+export struct theme_usage {
+  /// Palette slots, bit per slot
+  std::uint32_t palette = 0;
+  /// Theme fields, see theme_field
+  std::uint32_t fields = 0;
+
+  auto empty() const noexcept -> bool {
+    return palette == 0 && fields == 0;
+  }
+
+  auto intersects(theme_usage const& other) const noexcept -> bool {
+    return (palette & other.palette) != 0 || (fields & other.fields) != 0;
+  }
+
+  auto operator|=(theme_usage const& other) noexcept -> theme_usage& {
+    palette |= other.palette;
+    fields |= other.fields;
+    return *this;
+  }
+};
+
+/// Usage of every palette slot and field
+export constexpr theme_usage theme_usage_all = {0x00FFFFFFu,
+    theme_field_name | theme_field_author | theme_field_variant | theme_field_system};
+
+/// Statically find theme data referenced by parsed template and templates it includes or extends
+/// Whole palette is assumed when palette is iterated or passed as a whole to a function. Included templates are
+/// parsed by env through includes, so partials already parsed for rendering are shared.
+export [[nodiscard]] auto analyze_template(inja::Template const& tmpl, inja::Environment& env, include_cache& includes)
+    -> theme_usage;
+
+/// Theme data which differs between themes
+export [[nodiscard]] auto diff_themes(basexx_theme const& lhs, basexx_theme const& rhs) -> theme_usage;
+
+} // namespace walng
@@ -0,0 +1,244 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <format>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+import walng.basexx_theme;
+import walng.binary_io;
+import walng.builtin_templates;
+import walng.download;
+import walng.hash;
+import walng.store;
+import walng.utils;
+import walng.version;
+
+module walng.render_cache;
+
+namespace walng {
+namespace {
+
+constexpr std::uint64_t entry_magic = 0x31454352474e4c57ull; // "WLNGRCE1"
+
+/// Remote cache is best effort, slow server must not be slower than rendering
+constexpr std::chrono::milliseconds remote_timeout{2000};
+
+/// Skip spaces and tabs starting at pos
+auto skip_blanks(std::string_view content, std::size_t pos) noexcept -> std::size_t {
+  while (pos < content.size() && (content[pos] == ' ' || content[pos] == '\t')) {
+    ++pos;
+  }
+  return pos;
+}
+
+/// Template name of `include "name"` / `extends "name"` statement body starting at pos
+auto parse_include_statement(std::string_view content, std::size_t pos) -> std::optional<std::string_view> {
+  pos = skip_blanks(content, pos);
+  auto const rest = content.substr(pos);
+  if (!rest.starts_with("include") && !rest.starts_with("extends")) {
+    return std::nullopt;
+  }
+  pos = skip_blanks(content, pos + 7);
+  if (pos >= content.size() || content[pos] != '"') {
+    return std::nullopt;
+  }
+  auto const end = content.find('"', pos + 1);
+  if (end == content.npos) {
+    return std::nullopt;
+  }
+  return content.substr(pos + 1, end - pos - 1);
+}
+
+/// Names of templates included by template content ("{% include %}" and "## include" forms)
+auto find_included_templates(std::string_view content) -> std::vector<std::string_view> {
+  std::vector<std::string_view> result;
+
+  for (auto pos = content.find("{%"); pos != content.npos; pos = content.find("{%", pos)) {
+    pos += 2;
+    if (pos < content.size() && (content[pos] == '-' || content[pos] == '+')) {
+      ++pos;
+    }
+    if (auto const name = parse_include_statement(content, pos); name) {
+      result.push_back(*name);
+    }
+  }
+
+  for (auto pos = content.find("##"); pos != content.npos; pos = content.find("##", pos + 2)) {
+    auto const line_begin = content.rfind('\n', pos);
+    auto const indent_begin = line_begin == content.npos ? 0 : line_begin + 1;
+    if (skip_blanks(content, indent_begin) != pos) {
+      continue;
+    }
+    if (auto const name = parse_include_statement(content, pos + 2); name) {
+      result.push_back(*name);
+    }
+  }
+
+  return result;
+}
+
+/// Cache entry: rendered content with its hash, so truncated or corrupted entries are never used
+auto make_entry(std::string_view content) -> std::string {
+  binary_writer writer;
+  writer.write(entry_magic);
+  writer.write(hash_string(content));
+  writer.write_string(content);
+  return writer.release();
+}
+
+/// Rendered content of entry, std::nullopt if entry is invalid
+auto parse_entry(std::string_view entry) -> std::optional<std::string> {
+  binary_reader reader(entry);
+  std::uint64_t magic;
+  std::uint64_t content_hash;
+  std::string_view content;
+  if (!reader.read(magic) || magic != entry_magic || !reader.read(content_hash) || !reader.read_string(content) ||
+      !reader.empty() || hash_string(content) != content_hash) {
+    return std::nullopt;
+  }
+  return std::string(content);
+}
+
+} // namespace
+
+auto hash_theme(hasher& result, basexx_theme const& theme) -> void {
+  result.update(theme.name).update(theme.author).update(theme.variant).update(theme.system);
+  result.update(theme.palette.size());
+  for (auto const& color : theme.palette) {
+    result.update(color.value);
+  }
+}
+
+auto scan_template_dependencies(std::filesystem::path const& template_path)
+    -> std::expected<std::vector<std::filesystem::path>, std::string> {
+  std::vector<std::filesystem::path> result;
+  std::unordered_set<std::string> visited = {template_path.native()};
+  std::vector<std::filesystem::path> pending = {template_path};
+
+  while (!pending.empty()) {
+    auto const path = std::move(pending.back());
+    pending.pop_back();
+
+    auto const content = read_template(path);
+    if (!content) {
+      return std::unexpected(std::format("failed to read template '{}' ({})", path.c_str(), content.error()));
+    }
+
+    // inja concatenates directory of including template and included name
+    auto const directory = path.has_parent_path() ? path.parent_path().native() + "/" : std::string();
+    for (auto const name : find_included_templates(*content)) {
+      auto included_path = std::filesystem::path(directory + std::string(name));
+      if (visited.insert(included_path.native()).second) {
+        result.push_back(included_path);
+        pending.push_back(std::move(included_path));
+      }
+    }
+  }
+
+  return {std::move(result)};
+}
+
+auto hash_template_tree(std::filesystem::path const& template_path) -> std::expected<std::uint64_t, std::string> {
+  auto const content = read_template(template_path);
+  if (!content) {
+    return std::unexpected(std::format("failed to read template '{}' ({})", template_path.c_str(), content.error()));
+  }
+  auto const dependencies = scan_template_dependencies(template_path);
+  if (!dependencies) {
+    return std::unexpected(dependencies.error());
+  }
+
+  hasher result;
+  result.update(hash_string(*content)).update(dependencies->size());
+  for (auto const& path : *dependencies) {
+    auto const dependency_content = read_template(path);
+    if (!dependency_content) {
+      return std::unexpected(
+          std::format("failed to read template '{}' ({})", path.c_str(), dependency_content.error()));
+    }
+    auto const name = path.lexically_relative(template_path.parent_path());
+    result.update(name.native()).update(hash_string(*dependency_content));
+  }
+  return result.digest();
+}
+
+render_cache::render_cache(std::filesystem::path root, std::string url)
+    : root_(std::move(root)), entries_(root_ / "entries"), url_(std::move(url)) {
+  while (url_.ends_with('/')) {
+    url_.pop_back();
+  }
+}
+
+auto render_cache::key(std::filesystem::path const& template_path, basexx_theme const& theme) const
+    -> std::expected<std::uint64_t, std::string> {
+  // template location isn't part of key, same templates share entries wherever they are installed
+  auto const template_hash = hash_template_tree(template_path);
+  if (!template_hash) {
+    return std::unexpected(template_hash.error());
+  }
+
+  hasher result;
+  result.update(std::string_view(version)).update(*template_hash);
+  hash_theme(result, theme);
+  return result.digest();
+}
+
+auto render_cache::get(std::uint64_t key) const -> std::optional<std::string> {
+  if (auto const entry = read_file(entries_.path(key)); entry) {
+    if (auto content = parse_entry(*entry); content) {
+      return content;
+    }
+  }
+  if (url_.empty()) {
+    return std::nullopt;
+  }
+
+  auto const response = download(std::format("{}/{}", url_, hash_to_hex_str(key).string()), remote_timeout);
+  if (!response || response->response_code != 200 || !response->content) {
+    return std::nullopt;
+  }
+  auto content = parse_entry(*response->content);
+  if (content) {
+    [[maybe_unused]] auto const rc = write_file(entries_.path(key), *response->content);
+  }
+  return content;
+}
+
+auto render_cache::put(std::uint64_t key, std::string_view content) const -> std::expected<void, std::string> {
+  auto const entry = make_entry(content);
+  if (auto const rc = write_file(entries_.path(key), entry); !rc) {
+    return std::unexpected(rc.error());
+  }
+  if (url_.empty()) {
+    return {};
+  }
+
+  auto const response_code = upload(std::format("{}/{}", url_, hash_to_hex_str(key).string()), entry, remote_timeout);
+  if (!response_code) {
+    return std::unexpected(response_code.error());
+  }
+  if (*response_code < 200 || *response_code >= 300) {
+    return std::unexpected(std::format("upload error (response_code {})", *response_code));
+  }
+  return {};
+}
+
+auto get_render_cache_path() -> std::expected<std::filesystem::path, std::string> {
+  return get_cache_path().transform([](std::filesystem::path const& path) {
+    return path / "render";
+  });
+}
+
+} // namespace walng
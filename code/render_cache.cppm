@@ -0,0 +1,84 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+import walng.basexx_theme;
+import walng.hash;
+import walng.store;
+
+export module walng.render_cache;
+
+namespace walng {
+
+/// Templates included or extended by template file, transitively
+/// Include statements are found by scanning template text, names are resolved against including template directory
+/// as inja does.
+export [[nodiscard]] auto scan_template_dependencies(std::filesystem::path const& template_path)
+    -> std::expected<std::vector<std::filesystem::path>, std::string>;
+
+/// Hash of template content and of every template it includes or extends
+/// Included templates are hashed by name relative to template directory and content, so the hash doesn't depend on
+/// where templates live and changes whenever a partial is edited.
+export [[nodiscard]] auto hash_template_tree(std::filesystem::path const& template_path)
+    -> std::expected<std::uint64_t, std::string>;
+
+/// Hash theme content: names and palette
+export auto hash_theme(hasher& result, basexx_theme const& theme) -> void;
+
+/// Rendered outputs cache, ccache-like
+/// Key covers walng version, template content, names and content of included templates and theme, but not where
+/// templates are installed. Entries are kept in local directory and optionally shared through HTTP server (GET / PUT
+/// of <url>/<key>); every entry carries hash of its content, entries which don't match it are ignored.
+export class render_cache {
+private:
+  std::filesystem::path root_;
+  blob_store entries_;
+  std::string url_;
+
+public:
+  explicit render_cache(std::filesystem::path root, std::string url = {});
+
+  /// Key of template rendered with theme
+  [[nodiscard]] auto key(std::filesystem::path const& template_path, basexx_theme const& theme) const
+      -> std::expected<std::uint64_t, std::string>;
+
+  /// Lookup local entries first, then remote ones (remote hits are stored locally)
+  [[nodiscard]] auto get(std::uint64_t key) const -> std::optional<std::string>;
+
+  /// Store entry locally and remotely
+  auto put(std::uint64_t key, std::string_view content) const -> std::expected<void, std::string>;
+
+  /// Rendered template from cache, render_fn is invoked on miss and its result is stored
+  /// Cache failures only cost a render, failure to store result is reported to error when it's given.
+  template <typename Fn>
+  auto get_or_render(std::filesystem::path const& template_path, basexx_theme const& theme, Fn&& render_fn,
+      std::string* error = nullptr) const -> std::string {
+    auto const entry_key = key(template_path, theme);
+    if (!entry_key) {
+      return render_fn();
+    }
+    if (auto content = get(*entry_key); content) {
+      return std::move(content.value());
+    }
+    std::string content = render_fn();
+    if (auto const rc = put(*entry_key, content); !rc && error) {
+      *error = rc.error();
+    }
+    return content;
+  }
+};
+
+/// Local render cache location, $XDG_CACHE_HOME/walng/render
+export [[nodiscard]] auto get_render_cache_path() -> std::expected<std::filesystem::path, std::string>;
+
+} // namespace walng
@@ -0,0 +1,229 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <doctest/doctest.h>
+
+import walng.basexx_theme;
+import walng.color;
+import walng.render_cache;
+import walng.utils;
+
+namespace {
+
+/// Minimal HTTP server keeping PUT bodies in memory and serving them on GET, one request per connection
+class test_http_server {
+private:
+  int fd_ = -1;
+  std::uint16_t port_ = 0;
+  std::atomic<bool> stop_ = false;
+  std::mutex mutex_;
+  std::map<std::string, std::string> entries_;
+  std::thread thread_;
+
+  auto serve(int client) -> void {
+    std::string request;
+    char buffer[4096];
+    std::size_t header_end = std::string::npos;
+    while (header_end == std::string::npos) {
+      auto const rc = ::read(client, buffer, sizeof(buffer));
+      if (rc <= 0) {
+        return;
+      }
+      request.append(buffer, static_cast<std::size_t>(rc));
+      header_end = request.find("\r\n\r\n");
+    }
+    auto const headers = std::string_view(request).substr(0, header_end);
+    auto const method = headers.substr(0, headers.find(' '));
+    auto const path_begin = headers.find(' ') + 1;
+    auto const path = std::string(headers.substr(path_begin, headers.find(' ', path_begin) - path_begin));
+
+    std::string response;
+    if (method == "PUT") {
+      std::size_t length = 0;
+      if (auto const found = headers.find("Content-Length: "); found != headers.npos) {
+        length = std::strtoull(headers.data() + found + 16, nullptr, 10);
+      }
+      if (headers.find("100-continue") != headers.npos) {
+        std::string_view const reply = "HTTP/1.1 100 Continue\r\n\r\n";
+        [[maybe_unused]] auto const rc = ::write(client, reply.data(), reply.size());
+      }
+      std::string body = request.substr(header_end + 4);
+      while (body.size() < length) {
+        auto const rc = ::read(client, buffer, sizeof(buffer));
+        if (rc <= 0) {
+          return;
+        }
+        body.append(buffer, static_cast<std::size_t>(rc));
+      }
+      std::lock_guard lock(mutex_);
+      entries_[path] = std::move(body);
+      response = "HTTP/1.1 201 Created\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    } else {
+      std::lock_guard lock(mutex_);
+      if (auto const found = entries_.find(path); found != entries_.end()) {
+        response = std::format("HTTP/1.1 200 OK\r\nContent-Length: {}\r\nConnection: close\r\n\r\n{}",
+            found->second.size(), found->second);
+      } else {
+        response = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+      }
+    }
+    [[maybe_unused]] auto const rc = ::write(client, response.data(), response.size());
+  }
+
+public:
+  test_http_server() {
+    fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    ::sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::socklen_t size = sizeof(address);
+    REQUIRE(::bind(fd_, reinterpret_cast<::sockaddr*>(&address), sizeof(address)) == 0);
+    REQUIRE(::listen(fd_, 16) == 0);
+    REQUIRE(::getsockname(fd_, reinterpret_cast<::sockaddr*>(&address), &size) == 0);
+    port_ = ntohs(address.sin_port);
+    thread_ = std::thread([this] {
+      while (!stop_) {
+        int const client = ::accept(fd_, nullptr, nullptr);
+        if (client == -1) {
+          continue;
+        }
+        serve(client);
+        ::close(client);
+      }
+    });
+  }
+
+  ~test_http_server() {
+    stop_ = true;
+    ::shutdown(fd_, SHUT_RDWR);
+    thread_.join();
+    ::close(fd_);
+  }
+
+  auto url() const -> std::string {
+    return std::format("http://127.0.0.1:{}/cache", port_);
+  }
+
+  auto size() -> std::size_t {
+    std::lock_guard lock(mutex_);
+    return entries_.size();
+  }
+
+  /// Replace every stored entry with content
+  auto corrupt(std::string_view content) -> void {
+    std::lock_guard lock(mutex_);
+    for (auto& [_, value] : entries_) {
+      value = content;
+    }
+  }
+};
+
+auto make_theme() -> walng::basexx_theme {
+  walng::basexx_theme result;
+  result.name = "Test";
+  result.author = "walng";
+  result.variant = "dark";
+  result.system = "base16";
+  for (std::uint32_t index = 0; index < 16; ++index) {
+    result.palette.push_back(walng::color{0x102030u + index * 0x070503u});
+  }
+  return result;
+}
+
+auto make_root(std::string_view name) -> std::filesystem::path {
+  auto const result =
+      std::filesystem::temp_directory_path() / std::format("walng-{}-test-{}", name, walng::make_random_name());
+  std::filesystem::create_directories(result);
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("render cache key doesn't depend on template location") {
+  auto const root = make_root("render-cache");
+  for (auto const* directory : {"a", "b"}) {
+    REQUIRE(walng::write_file(root / directory / "partial.tmpl", "{{ palette.base00 }}"));
+    REQUIRE(walng::write_file(root / directory / "main.tmpl", "{% include \"partial.tmpl\" %}"));
+  }
+  walng::render_cache const cache(root / "cache");
+  auto const theme = make_theme();
+
+  auto const a = cache.key(root / "a" / "main.tmpl", theme);
+  auto const b = cache.key(root / "b" / "main.tmpl", theme);
+  REQUIRE(a);
+  REQUIRE(b);
+  CHECK(*a == *b);
+
+  REQUIRE(walng::write_file(root / "b" / "partial.tmpl", "{{ palette.base01 }}"));
+  auto const changed = cache.key(root / "b" / "main.tmpl", theme);
+  REQUIRE(changed);
+  CHECK(*changed != *a);
+
+  auto other_theme = theme;
+  other_theme.palette[0] = walng::color{0xffffffu};
+  CHECK(cache.key(root / "a" / "main.tmpl", other_theme).value() != *a);
+
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("render cache ignores corrupted local entries") {
+  auto const root = make_root("render-cache");
+  walng::render_cache const cache(root / "cache");
+
+  REQUIRE(cache.put(1, "rendered"));
+  CHECK(cache.get(1) == "rendered");
+  CHECK_FALSE(cache.get(2));
+
+  for (auto const& file : std::filesystem::recursive_directory_iterator(root / "cache")) {
+    if (file.is_regular_file()) {
+      auto content = walng::read_file(file.path()).value();
+      content.back() ^= 1;
+      REQUIRE(walng::write_file(file.path(), content));
+    }
+  }
+  CHECK_FALSE(cache.get(1));
+
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("render cache shares verified entries through HTTP server") {
+  ::setenv("no_proxy", "127.0.0.1", 1);
+  auto const root = make_root("render-cache");
+  test_http_server server;
+
+  walng::render_cache const writer(root / "writer", server.url());
+  REQUIRE(writer.put(1, "rendered"));
+  CHECK(server.size() == 1);
+
+  walng::render_cache const reader(root / "reader", server.url());
+  CHECK(reader.get(1) == "rendered");
+  CHECK_FALSE(reader.get(2));
+
+  // fetched entry is kept locally
+  walng::render_cache const offline(root / "reader");
+  CHECK(offline.get(1) == "rendered");
+
+  server.corrupt("not an entry");
+  walng::render_cache const other(root / "other", server.url());
+  CHECK_FALSE(other.get(1));
+  walng::render_cache const offline_other(root / "other");
+  CHECK_FALSE(offline_other.get(1));
+
+  std::filesystem::remove_all(root);
+}
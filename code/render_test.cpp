@@ -0,0 +1,76 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <doctest/doctest.h>
+#include <inja/inja.hpp>
+
+import walng.render;
+
+namespace {
+
+auto find_callback(std::string_view name) -> walng::template_callback const& {
+  for (auto const& callback : walng::get_template_callbacks()) {
+    if (callback.name == name) {
+      return callback;
+    }
+  }
+  throw std::runtime_error("unknown callback");
+}
+
+} // namespace
+
+TEST_CASE("callback memo answers repeated calls by argument values") {
+  walng::callback_memo memo;
+  auto const& alpha = find_callback("alpha");
+
+  inja::json const color = "#102030";
+  inja::json const same_color = "#102030";
+  inja::json const other_color = "#405060";
+  inja::json const value = 0.5;
+
+  inja::Arguments first{&color, &value};
+  CHECK(memo.call(alpha, first) == "#10203080");
+  CHECK(memo.misses() == 1);
+
+  // equal values at different addresses share the result
+  inja::Arguments second{&same_color, &value};
+  CHECK(memo.call(alpha, second) == "#10203080");
+  CHECK(memo.hits() == 1);
+
+  inja::Arguments third{&other_color, &value};
+  CHECK(memo.call(alpha, third) == "#40506080");
+  CHECK(memo.misses() == 2);
+
+  // same arguments of another callback are a different call
+  inja::Arguments fourth{&color};
+  CHECK(memo.call(find_callback("rgb"), fourth) != memo.call(alpha, first));
+  CHECK(memo.misses() == 3);
+}
+
+TEST_CASE("loop temporaries are released between iterations") {
+  auto env = walng::get_inja_env();
+
+  CHECK(env.render("{% for x in range(3) %}{% for y in range(2) %}{{ x }}{{ y }}{% endfor %}{% endfor %}",
+            inja::json::object()) == "000110112021");
+
+  std::string expected;
+  for (int i = 0; i < 1000; ++i) {
+    expected += "16, 32, 48;";
+  }
+  CHECK(env.render("{% for x in range(1000) %}{{ rgb(color) }};{% endfor %}", {{"color", "#102030"}}) == expected);
+}
+
+TEST_CASE("extends inside loop keeps loop temporaries") {
+  auto env = walng::get_inja_env();
+  env.include_template("base", env.parse("<{{ x }}>"));
+
+  // parent is rendered by the same renderer in the middle of the loop, loop range must survive it
+  CHECK(env.render("{% for x in range(3) %}{{ x }}{% extends \"base\" %}{% endfor %}", inja::json::object()) ==
+        "0<0>12");
+  CHECK(env.render("{% for x in range(3) %}{% if x == 1 %}{% extends \"base\" %}{% endif %}{{ x }}{% endfor %}",
+            inja::json::object()) == "0<1>");
+}
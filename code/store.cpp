@@ -0,0 +1,138 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+import walng.hash;
+import walng.utils;
+
+module walng.store;
+
+namespace walng {
+namespace {
+
+/// Copy whole file content, kernel side when possible
+auto copy_file_content(int source_fd, int target_fd) -> bool {
+  if (::ioctl(target_fd, FICLONE, source_fd) == 0) {
+    return true;
+  }
+
+  struct ::stat st;
+  if (::fstat(source_fd, &st) != 0) {
+    return false;
+  }
+  auto remaining = static_cast<std::size_t>(st.st_size);
+  while (remaining > 0) {
+    auto const rc = ::sendfile(target_fd, source_fd, nullptr, remaining);
+    if (rc == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    if (rc == 0) {
+      break;
+    }
+    remaining -= static_cast<std::size_t>(rc);
+  }
+  return true;
+}
+
+} // namespace
+
+auto blob_store::path(std::uint64_t hash) const -> std::filesystem::path {
+  auto const name = hash_to_hex_str(hash);
+  return root_ / name.string().substr(0, 2) / name.string();
+}
+
+auto blob_store::contains(std::uint64_t hash) const -> bool {
+  std::error_code ec;
+  return std::filesystem::is_regular_file(path(hash), ec);
+}
+
+auto blob_store::put(std::string_view content) const -> std::expected<std::uint64_t, std::string> {
+  return put(std::span<std::string_view const>(&content, 1));
+}
+
+auto blob_store::put(std::span<std::string_view const> spans) const -> std::expected<std::uint64_t, std::string> {
+  hasher content_hasher;
+  for (auto const span : spans) {
+    content_hasher.update(span);
+  }
+  auto const hash = content_hasher.digest();
+  if (contains(hash)) {
+    return hash;
+  }
+  if (auto const rc = write_file(path(hash), spans, mode_); !rc) {
+    return std::unexpected(rc.error());
+  }
+  return hash;
+}
+
+auto install_file_atomic(std::filesystem::path const& source, std::filesystem::path const& target, write_mode mode)
+    -> std::expected<void, std::string> {
+  std::error_code ec;
+  if (auto const parent_path = target.parent_path(); !parent_path.empty()) {
+    std::filesystem::create_directories(parent_path, ec);
+    if (ec) {
+      return std::unexpected(ec.message());
+    }
+  }
+
+  int const source_fd = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+  if (source_fd == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+
+  auto temp_path = target;
+  temp_path += "." + make_random_name();
+
+  int const target_fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (target_fd == -1) {
+    auto const error = errno;
+    ::close(source_fd);
+    return std::unexpected(std::strerror(error));
+  }
+
+  int error = 0;
+  if (!copy_file_content(source_fd, target_fd) || (mode == write_mode::durable && ::fsync(target_fd) == -1)) {
+    error = errno;
+  }
+  // close reports delayed write errors, copy isn't installed then
+  if (::close(target_fd) == -1 && error == 0) {
+    error = errno;
+  }
+  ::close(source_fd);
+  if (error != 0) {
+    ::unlink(temp_path.c_str());
+    return std::unexpected(std::strerror(error));
+  }
+
+  std::filesystem::rename(temp_path, target, ec);
+  if (ec) {
+    ::unlink(temp_path.c_str());
+    return std::unexpected(ec.message());
+  }
+  if (mode == write_mode::durable) {
+    return sync_directory(target.parent_path());
+  }
+  return {};
+}
+
+} // namespace walng
@@ -0,0 +1,57 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+import walng.utils;
+
+export module walng.store;
+
+namespace walng {
+
+/// Content-addressed file store, blob name is hash of its content
+export class blob_store {
+private:
+  std::filesystem::path root_;
+  write_mode mode_;
+
+public:
+  explicit blob_store(std::filesystem::path root, write_mode mode = write_mode::atomic)
+      : root_(std::move(root)), mode_(mode) {}
+
+  auto root() const noexcept -> std::filesystem::path const& {
+    return root_;
+  }
+
+  /// How blobs are written
+  auto mode() const noexcept -> write_mode {
+    return mode_;
+  }
+
+  /// Path of blob with given content hash
+  auto path(std::uint64_t hash) const -> std::filesystem::path;
+
+  auto contains(std::uint64_t hash) const -> bool;
+
+  /// Store content (no-op if same content already stored), returns content hash
+  auto put(std::string_view content) const -> std::expected<std::uint64_t, std::string>;
+
+  /// Store content made of spans, hash is the same as of concatenated content
+  auto put(std::span<std::string_view const> spans) const -> std::expected<std::uint64_t, std::string>;
+};
+
+/// Replace target with a copy of source atomically
+/// Copy is reflinked (FICLONE) when file system supports it, otherwise regular copy is made; copy is created next to
+/// target and renamed over it, so readers of target never see partial content.
+export [[nodiscard]] auto install_file_atomic(std::filesystem::path const& source, std::filesystem::path const& target,
+    write_mode mode = write_mode::atomic) -> std::expected<void, std::string>;
+
+} // namespace walng
@@ -0,0 +1,393 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <format>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <inja/inja.hpp>
+
+import walng.basexx_theme;
+import walng.render;
+
+module walng.template_vm;
+
+namespace walng {
+namespace {
+
+constexpr std::array<std::string_view, 5> field_names = {"palette", "name", "author", "variant", "system"};
+
+/// Slot index of "palette.baseXX" name
+auto parse_slot_name(std::string_view name) -> std::optional<std::uint32_t> {
+  constexpr std::string_view prefix = "palette.";
+  if (!name.starts_with(prefix)) {
+    return std::nullopt;
+  }
+  name.remove_prefix(prefix.size());
+  for (std::uint32_t index = 0; index < 24; ++index) {
+    if (basexx_theme_color_name(index) == name) {
+      return index;
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace
+
+/// Lowers template AST, first unsupported node stops compilation
+class template_program::compiler : public inja::NodeVisitor {
+private:
+  template_program& program_;
+  std::string_view content_;
+  std::string error_;
+  /// Loop variables in scope, innermost last
+  std::vector<std::pair<std::string, std::uint32_t>> locals_;
+  std::uint32_t depth_ = 0;
+
+  auto emit(template_opcode op, std::uint32_t a = 0, std::uint32_t b = 0) -> std::size_t {
+    program_.code_.push_back(template_instruction{op, a, b});
+    return program_.code_.size() - 1;
+  }
+
+  auto label() const noexcept -> std::uint32_t {
+    return static_cast<std::uint32_t>(program_.code_.size());
+  }
+
+  void unsupported(std::string_view what) {
+    if (error_.empty()) {
+      error_ = std::format("unsupported {}", what);
+    }
+  }
+
+  void compile_expression(inja::ExpressionNode const* node) {
+    if (!node) {
+      unsupported("empty expression");
+      return;
+    }
+    node->accept(*this);
+  }
+
+public:
+  compiler(template_program& program, std::string_view content) : program_(program), content_(content) {}
+
+  auto error() const noexcept -> std::string const& {
+    return error_;
+  }
+
+  void visit(inja::BlockNode const& node) override {
+    for (auto const& child : node.nodes) {
+      if (!error_.empty()) {
+        return;
+      }
+      child->accept(*this);
+    }
+  }
+
+  void visit(inja::TextNode const& node) override {
+    auto& text = program_.text_;
+    auto const offset = static_cast<std::uint32_t>(text.size());
+    text.append(content_.substr(node.pos, node.length));
+    // adjacent text nodes become one append
+    if (!program_.code_.empty() && program_.code_.back().op == template_opcode::text &&
+        program_.code_.back().a + program_.code_.back().b == offset) {
+      program_.code_.back().b += static_cast<std::uint32_t>(node.length);
+      return;
+    }
+    emit(template_opcode::text, offset, static_cast<std::uint32_t>(node.length));
+  }
+
+  void visit(inja::ExpressionNode const&) override {
+    unsupported("expression");
+  }
+
+  void visit(inja::LiteralNode const& node) override {
+    program_.constants_.push_back(node.value);
+    emit(template_opcode::push_constant, static_cast<std::uint32_t>(program_.constants_.size() - 1));
+  }
+
+  void visit(inja::DataNode const& node) override {
+    for (auto it = locals_.rbegin(); it != locals_.rend(); ++it) {
+      if (it->first == node.name) {
+        emit(template_opcode::push_local, it->second);
+        return;
+      }
+    }
+    if (auto const slot = parse_slot_name(node.name); slot) {
+      emit(template_opcode::push_slot, *slot);
+      return;
+    }
+    for (std::uint32_t index = 0; index < field_names.size(); ++index) {
+      if (field_names[index] == node.name) {
+        emit(template_opcode::push_field, index);
+        return;
+      }
+    }
+    unsupported(std::format("variable '{}'", node.name));
+  }
+
+  void visit(inja::FunctionNode const& node) override {
+    using op = inja::FunctionStorage::Operation;
+    switch (node.operation) {
+    case op::Callback: {
+      auto const callbacks = get_template_callbacks();
+      auto const argc = static_cast<int>(node.arguments.size());
+      std::size_t found = callbacks.size();
+      for (std::size_t index = 0; index < callbacks.size(); ++index) {
+        if (callbacks[index].name == node.name && callbacks[index].argc == argc) {
+          found = index;
+        }
+      }
+      if (found == callbacks.size()) {
+        unsupported(std::format("function '{}'", node.name));
+        return;
+      }
+      for (auto const& argument : node.arguments) {
+        compile_expression(argument.get());
+      }
+      program_.callbacks_.push_back(&callbacks[found]);
+      emit(template_opcode::call, static_cast<std::uint32_t>(program_.callbacks_.size() - 1),
+          static_cast<std::uint32_t>(argc));
+    } break;
+    case op::Not:
+      if (node.arguments.size() != 1) {
+        unsupported("'not' arguments");
+        return;
+      }
+      compile_expression(node.arguments[0].get());
+      emit(template_opcode::logical_not);
+      break;
+    case op::Equal:
+    case op::NotEqual:
+      if (node.arguments.size() != 2) {
+        unsupported("comparison arguments");
+        return;
+      }
+      compile_expression(node.arguments[0].get());
+      compile_expression(node.arguments[1].get());
+      emit(node.operation == op::Equal ? template_opcode::equal : template_opcode::not_equal);
+      break;
+    default:
+      unsupported(std::format("function '{}'", node.name));
+      break;
+    }
+  }
+
+  void visit(inja::ExpressionListNode const& node) override {
+    compile_expression(node.root.get());
+    emit(template_opcode::print);
+  }
+
+  void visit(inja::StatementNode const&) override {
+    unsupported("statement");
+  }
+
+  void visit(inja::ForStatementNode const&) override {
+    unsupported("loop");
+  }
+
+  void visit(inja::ForArrayStatementNode const&) override {
+    unsupported("array loop");
+  }
+
+  void visit(inja::ForObjectStatementNode const& node) override {
+    auto const* data = dynamic_cast<inja::DataNode const*>(node.condition.root.get());
+    if (!data || data->name != "palette") {
+      unsupported("loop over anything but palette");
+      return;
+    }
+
+    auto const depth = depth_++;
+    program_.loop_depth_ = std::max(program_.loop_depth_, depth_);
+    locals_.emplace_back(node.key, 2 * depth);
+    locals_.emplace_back(node.value, 2 * depth + 1);
+
+    auto const begin = emit(template_opcode::loop_begin, depth);
+    auto const body = label();
+    node.body.accept(*this);
+    emit(template_opcode::loop_next, depth, body);
+    program_.code_[begin].b = label();
+
+    locals_.resize(locals_.size() - 2);
+    --depth_;
+  }
+
+  void visit(inja::IfStatementNode const& node) override {
+    compile_expression(node.condition.root.get());
+    auto const jump_to_false = emit(template_opcode::jump_if_false);
+    node.true_statement.accept(*this);
+    if (node.has_false_statement) {
+      auto const jump_to_end = emit(template_opcode::jump);
+      program_.code_[jump_to_false].a = label();
+      node.false_statement.accept(*this);
+      program_.code_[jump_to_end].a = label();
+    } else {
+      program_.code_[jump_to_false].a = label();
+    }
+  }
+
+  void visit(inja::IncludeStatementNode const&) override {
+    unsupported("include");
+  }
+
+  void visit(inja::ExtendsStatementNode const&) override {
+    unsupported("extends");
+  }
+
+  void visit(inja::BlockStatementNode const&) override {
+    unsupported("block");
+  }
+
+  void visit(inja::SetStatementNode const&) override {
+    unsupported("set");
+  }
+};
+
+auto template_program::compile(inja::Template const& tmpl) -> std::expected<template_program, std::string> {
+  template_program result;
+  compiler visitor(result, tmpl.content);
+  tmpl.root.accept(visitor);
+  if (!visitor.error().empty()) {
+    return std::unexpected(visitor.error());
+  }
+  return {std::move(result)};
+}
+
+template <typename Sink>
+auto template_program::execute(theme_data_provider const& data, Sink&& sink) const -> void {
+  static inja::json const true_value = true;
+  static inja::json const false_value = false;
+
+  std::vector<inja::json const*> stack;
+  std::vector<inja::json const*> locals(2 * loop_depth_);
+  std::vector<std::size_t> loop_indexes(loop_depth_);
+  inja::Arguments arguments;
+
+  auto const pop = [&stack] {
+    auto const result = stack.back();
+    stack.pop_back();
+    return result;
+  };
+  auto const set_loop_locals = [&](std::uint32_t depth) {
+    auto const index = loop_indexes[depth];
+    locals[2 * depth] = &get_palette_slot_name(index);
+    locals[2 * depth + 1] = data.slot(index);
+  };
+
+  for (std::size_t pc = 0; pc < code_.size();) {
+    auto const& instruction = code_[pc++];
+    switch (instruction.op) {
+    case template_opcode::text:
+      sink(std::string_view(text_).substr(instruction.a, instruction.b), true);
+      break;
+    case template_opcode::print:
+      if (inja::json const* value = pop(); value->is_string()) {
+        sink(std::string_view(value->get_ref<inja::json::string_t const&>()), false);
+      } else {
+        std::string text;
+        append_template_value(text, *value);
+        sink(std::string_view(text), false);
+      }
+      break;
+    case template_opcode::push_slot:
+      if (instruction.a >= data.palette_size()) {
+        throw std::runtime_error(
+            std::format("variable 'palette.{}' not found", basexx_theme_color_name(instruction.a)));
+      }
+      stack.push_back(data.slot(instruction.a));
+      break;
+    case template_opcode::push_field:
+      stack.push_back(data.field(instruction.a));
+      break;
+    case template_opcode::push_local:
+      stack.push_back(locals[instruction.a]);
+      break;
+    case template_opcode::push_constant:
+      stack.push_back(&constants_[instruction.a]);
+      break;
+    case template_opcode::call:
+      arguments.assign(stack.end() - instruction.b, stack.end());
+      stack.resize(stack.size() - instruction.b);
+      // results live in theme memo, repeated calls with same arguments are lookups
+      stack.push_back(&data.memo().call(*callbacks_[instruction.a], arguments));
+      break;
+    case template_opcode::equal:
+    case template_opcode::not_equal: {
+      auto const rhs = pop();
+      auto const lhs = pop();
+      auto const equal = *lhs == *rhs;
+      stack.push_back(equal == (instruction.op == template_opcode::equal) ? &true_value : &false_value);
+    } break;
+    case template_opcode::logical_not:
+      stack.push_back(is_template_value_truthy(*pop()) ? &false_value : &true_value);
+      break;
+    case template_opcode::jump:
+      pc = instruction.a;
+      break;
+    case template_opcode::jump_if_false:
+      if (!is_template_value_truthy(*pop())) {
+        pc = instruction.a;
+      }
+      break;
+    case template_opcode::loop_begin:
+      if (data.palette_size() == 0) {
+        pc = instruction.b;
+        break;
+      }
+      loop_indexes[instruction.a] = 0;
+      set_loop_locals(instruction.a);
+      break;
+    case template_opcode::loop_next:
+      if (++loop_indexes[instruction.a] < data.palette_size()) {
+        set_loop_locals(instruction.a);
+        pc = instruction.b;
+      }
+      break;
+    }
+  }
+}
+
+auto template_program::render_to(std::string& output, theme_data_provider const& data) const -> void {
+  execute(data, [&output](std::string_view text, bool) {
+    output.append(text);
+  });
+}
+
+auto template_program::evaluate_into(template_spans& output, theme_data_provider const& data) const -> void {
+  output.values.clear();
+  output.spans.clear();
+  output.value_spans.clear();
+  // buffers keep capacity of previous evaluations, reserve covers the first one
+  output.spans.reserve(code_.size());
+  output.value_spans.reserve(code_.size());
+  execute(data, [&output](std::string_view text, bool is_program_text) {
+    if (text.empty()) {
+      return;
+    }
+    if (!is_program_text) {
+      // printed values may be temporaries of execution, span is pointed into values once they stop growing
+      output.value_spans.push_back(static_cast<std::uint32_t>(output.spans.size()));
+      output.values.append(text);
+    }
+    output.spans.push_back(text);
+  });
+
+  std::size_t offset = 0;
+  for (auto const index : output.value_spans) {
+    auto& span = output.spans[index];
+    span = std::string_view(output.values).substr(offset, span.size());
+    offset += span.size();
+  }
+}
+
+} // namespace walng
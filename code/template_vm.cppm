@@ -0,0 +1,109 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+module;
+
+#include <cstdint>
+#include <expected>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <inja/inja.hpp>
+
+import walng.render;
+
+export module walng.template_vm;
+
+namespace walng {
+
+export enum class template_opcode : std::uint8_t {
+  text,          ///< append text [a, a + b)
+  print,         ///< pop value and append it
+  push_slot,     ///< push palette slot a
+  push_field,    ///< push theme field a (see theme_data_provider::field)
+  push_local,    ///< push loop variable a
+  push_constant, ///< push constant a
+  call,          ///< call callback a with b arguments from stack, push result
+  equal,         ///< pop rhs and lhs, push lhs == rhs
+  not_equal,     ///< pop rhs and lhs, push lhs != rhs
+  logical_not,   ///< pop value, push !value
+  jump,          ///< jump to a
+  jump_if_false, ///< pop value, jump to a if value is falsy
+  loop_begin,    ///< start palette loop of depth a, jump to b if palette is empty
+  loop_next,     ///< advance palette loop of depth a, jump to b while slots are left
+};
+
+export struct template_instruction {
+  template_opcode op;
+  std::uint32_t a;
+  std::uint32_t b;
+};
+
+/// Template output for a fixed theme as a flat list of text spans
+/// Spans point into program text and into values folded during evaluation, so they are valid while both the
+/// program and this object are alive and until the next evaluation into this object. Buffers keep their capacity
+/// between evaluations, reused object renders without allocations.
+export struct template_spans {
+  /// Values folded during evaluation, concatenated
+  std::string values;
+  std::vector<std::string_view> spans;
+  /// Indexes of spans of values, they are pointed into values once evaluation is over and values stop growing
+  std::vector<std::uint32_t> value_spans;
+
+  auto size() const noexcept -> std::size_t {
+    std::size_t result = 0;
+    for (auto const span : spans) {
+      result += span.size();
+    }
+    return result;
+  }
+};
+
+/// Parsed template lowered to linear bytecode
+/// Supports text, palette / theme field output, walng callbacks, `==` / `!=` / `not`, if / else and loops over
+/// palette; templates with anything else are rejected by compile() and must be rendered by inja.
+export class template_program {
+private:
+  class compiler;
+
+  std::string text_;
+  std::vector<template_instruction> code_;
+  std::vector<inja::json> constants_;
+  std::vector<template_callback const*> callbacks_;
+  /// Max nesting of palette loops
+  std::uint32_t loop_depth_ = 0;
+
+  /// Run program, text is passed to sink as (text, is_program_text)
+  template <typename Sink>
+  auto execute(theme_data_provider const& data, Sink&& sink) const -> void;
+
+public:
+  [[nodiscard]] static auto compile(inja::Template const& tmpl) -> std::expected<template_program, std::string>;
+
+  auto code() const noexcept -> std::vector<template_instruction> const& {
+    return code_;
+  }
+
+  /// Execute program, callback and data errors are thrown as std::runtime_error
+  auto render_to(std::string& output, theme_data_provider const& data) const -> void;
+
+  [[nodiscard]] auto render(theme_data_provider const& data) const -> std::string {
+    std::string result;
+    render_to(result, data);
+    return result;
+  }
+
+  /// Evaluate program against a fixed theme without concatenating output, previous content of output is replaced
+  /// Theme is the only input of supported operations (walng callbacks are pure), so every expression folds to text
+  /// and palette loops unroll; literal text is referenced from program, not copied.
+  auto evaluate_into(template_spans& output, theme_data_provider const& data) const -> void;
+
+  [[nodiscard]] auto evaluate(theme_data_provider const& data) const -> template_spans {
+    template_spans result;
+    evaluate_into(result, data);
+    return result;
+  }
+};
+
+} // namespace walng
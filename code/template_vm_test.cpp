@@ -0,0 +1,80 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <cstdint>
+#include <string>
+
+#include <doctest/doctest.h>
+#include <inja/inja.hpp>
+
+import walng.basexx_theme;
+import walng.color;
+import walng.render;
+import walng.template_vm;
+
+namespace {
+
+auto make_theme() -> walng::basexx_theme {
+  walng::basexx_theme result;
+  result.name = "Test";
+  result.author = "walng";
+  result.variant = "dark";
+  result.system = "base16";
+  for (std::uint32_t index = 0; index < 16; ++index) {
+    result.palette.push_back(walng::color{0x102030u + index * 0x070503u});
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("template program renders like inja") {
+  auto env = walng::get_inja_env();
+  walng::theme_data_provider const data(make_theme());
+
+  for (std::string const source : {
+           "{{ name }} by {{ author }}: {{ palette.base00 }}",
+           "{% for name, color in palette %}{{ name }}={{ rgb(color) }}\n{% endfor %}",
+           "{% if variant == \"dark\" %}dark{% else %}light{% endif %}",
+           "{% if not (variant != \"light\") %}light{% endif %}",
+           "{{ alpha(palette.base0A, 0.25) }} {{ rgba(palette.base0F) }} {{ r(palette.base01) }}",
+           "{% for name, color in palette %}{% for other, value in palette %}{% if name == other %}{{ value }}"
+           "{% endif %}{% endfor %}{% endfor %}",
+       }) {
+    auto const tmpl = env.parse(source);
+    auto const program = walng::template_program::compile(tmpl);
+    REQUIRE(program);
+    auto const expected = env.render(tmpl, data.data(), data);
+    CHECK(program->render(data) == expected);
+
+    auto const output = program->evaluate(data);
+    std::string joined;
+    for (auto const span : output.spans) {
+      joined += span;
+    }
+    CHECK(joined == expected);
+    CHECK(output.size() == expected.size());
+
+    // reused output is replaced, spans point into its values
+    auto reused = program->evaluate(data);
+    program->evaluate_into(reused, data);
+    joined.clear();
+    for (auto const span : reused.spans) {
+      joined += span;
+    }
+    CHECK(joined == expected);
+  }
+}
+
+TEST_CASE("template program rejects unsupported templates") {
+  auto env = walng::get_inja_env();
+
+  for (std::string const source : {
+           "{% set x = 1 %}{{ x }}",
+           "{{ length(palette) }}",
+           "{% for x in range(3) %}{{ x }}{% endfor %}",
+           "{{ 1 + 2 }}",
+       }) {
+    CHECK_FALSE(walng::template_program::compile(env.parse(source)));
+  }
+}
@@ -3,17 +3,33 @@
 
 module;
 
-#include <array>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
 #include <expected>
 #include <filesystem>
+#include <format>
+#include <optional>
 #include <random>
+#include <span>
+#include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 export module walng.utils;
 
 namespace walng {
 
-auto get_home_path() -> std::expected<std::filesystem::path, std::string> {
+export auto get_home_path() -> std::expected<std::filesystem::path, std::string> {
   if (auto const result = ::secure_getenv("HOME"); result) {
     return std::filesystem::path(result);
   }
@@ -38,33 +54,310 @@ export auto get_cache_path() -> std::expected<std::filesystem::path, std::string
   });
 }
 
-export auto create_temporary_file_path() -> std::expected<std::filesystem::path, std::string> {
+/// Random file name of 16 chars
+export auto make_random_name() -> std::string {
   static constexpr std::string_view allowed_chars = "abcdefghijklmnaoqrstuvwxyz1234567890";
 
   std::random_device device;
   std::mt19937 gen(device());
   std::uniform_int_distribution<> dist(0, allowed_chars.size() - 1);
 
-  std::array<char, 16> temp_name;
-  for (auto& ch : temp_name) {
+  std::string result(16, '\0');
+  for (auto& ch : result) {
     ch = allowed_chars[dist(gen)];
   }
+  return result;
+}
 
+export auto create_temporary_file_path() -> std::expected<std::filesystem::path, std::string> {
   std::error_code ec;
   auto temp_directory_path = std::filesystem::temp_directory_path(ec);
   if (ec) {
     return std::unexpected(ec.message());
   }
-  return temp_directory_path / std::string_view(temp_name.data(), temp_name.size());
+  return temp_directory_path / make_random_name();
 }
 
-export auto expand_tilda(std::filesystem::path& path) -> std::expected<void, std::string> {
+/// Read whole file into a string
+export auto read_file(std::filesystem::path const& path) -> std::expected<std::string, std::string> {
+  int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+
+  std::string result;
+  struct ::stat st;
+  if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+    result.reserve(static_cast<std::size_t>(st.st_size));
+  }
+
+  char buffer[16384];
+  for (;;) {
+    auto const rc = ::read(fd, buffer, sizeof(buffer));
+    if (rc == 0) {
+      break;
+    }
+    if (rc == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      auto const error = errno;
+      ::close(fd);
+      return std::unexpected(std::strerror(error));
+    }
+    result.append(buffer, static_cast<std::size_t>(rc));
+  }
+
+  ::close(fd);
+  return {std::move(result)};
+}
+
+/// How written files are persisted
+export enum class write_mode : std::uint8_t {
+  /// File is replaced atomically, it may be lost on system crash
+  atomic,
+  /// File is replaced atomically, file and its directory entry are on disk once write returns
+  durable,
+};
+
+/// Flush directory entries (created, renamed files) to disk
+export auto sync_directory(std::filesystem::path const& path) -> std::expected<void, std::string> {
+  int const fd = ::open(path.empty() ? "." : path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+  auto const rc = ::fsync(fd);
+  auto const error = errno;
+  ::close(fd);
+  if (rc == -1) {
+    return std::unexpected(std::strerror(error));
+  }
+  return {};
+}
+
+/// Write content made of spans to file atomically (write temporary file next to destination and rename it)
+/// Spans are written with writev(2), so content is never concatenated in memory.
+export auto write_file(std::filesystem::path const& path, std::span<std::string_view const> spans,
+    write_mode mode = write_mode::atomic) -> std::expected<void, std::string> {
+  std::error_code ec;
+  if (auto const parent_path = path.parent_path(); !parent_path.empty()) {
+    std::filesystem::create_directories(parent_path, ec);
+    if (ec) {
+      return std::unexpected(ec.message());
+    }
+  }
+
+  std::vector<::iovec> iovecs;
+  iovecs.reserve(spans.size());
+  for (auto const span : spans) {
+    if (!span.empty()) {
+      iovecs.push_back(::iovec{const_cast<char*>(span.data()), span.size()});
+    }
+  }
+
+  auto temp_path = path;
+  temp_path += "." + make_random_name();
+
+  int const fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+  for (std::size_t first = 0; first < iovecs.size();) {
+    auto const count = std::min<std::size_t>(iovecs.size() - first, IOV_MAX);
+    auto rc = ::writev(fd, iovecs.data() + first, static_cast<int>(count));
+    if (rc == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      auto const error = errno;
+      ::close(fd);
+      ::unlink(temp_path.c_str());
+      return std::unexpected(std::strerror(error));
+    }
+    // skip written spans, continue from the middle of partially written one
+    while (first < iovecs.size() && static_cast<std::size_t>(rc) >= iovecs[first].iov_len) {
+      rc -= static_cast<::ssize_t>(iovecs[first].iov_len);
+      ++first;
+    }
+    if (rc > 0) {
+      iovecs[first].iov_base = static_cast<char*>(iovecs[first].iov_base) + rc;
+      iovecs[first].iov_len -= static_cast<std::size_t>(rc);
+    }
+  }
+  // close reports delayed write errors (NFS, quota), content isn't installed then
+  int error = 0;
+  if (mode == write_mode::durable && ::fsync(fd) == -1) {
+    error = errno;
+  }
+  if (::close(fd) == -1 && error == 0) {
+    error = errno;
+  }
+  if (error != 0) {
+    ::unlink(temp_path.c_str());
+    return std::unexpected(std::strerror(error));
+  }
+
+  std::filesystem::rename(temp_path, path, ec);
+  if (ec) {
+    ::unlink(temp_path.c_str());
+    return std::unexpected(ec.message());
+  }
+  if (mode == write_mode::durable) {
+    return sync_directory(path.parent_path());
+  }
+  return {};
+}
+
+/// Write content to file atomically (write temporary file next to destination and rename it)
+export auto write_file(std::filesystem::path const& path, std::string_view content,
+    write_mode mode = write_mode::atomic) -> std::expected<void, std::string> {
+  return write_file(path, std::span<std::string_view const>(&content, 1), mode);
+}
+
+/// Owner given to written files
+export struct file_owner {
+  ::uid_t uid;
+  ::gid_t gid;
+};
+
+/// Write content to file below root directory atomically, without following symlinks
+/// Every component of relative path is opened with O_NOFOLLOW relative to its parent, so symlinks planted below root
+/// can't redirect write outside of it; missing directories are created. Created directories and file are given to
+/// owner when it's set.
+export auto write_file_beneath(std::filesystem::path const& root, std::filesystem::path const& relative_path,
+    std::string_view content, std::optional<file_owner> owner = std::nullopt) -> std::expected<void, std::string> {
+  std::vector<std::string> names;
+  for (auto const& component : relative_path.lexically_normal()) {
+    if (component.empty() || component == "." || component == ".." || component.has_root_path()) {
+      return std::unexpected(std::format("invalid path '{}'", relative_path.c_str()));
+    }
+    names.push_back(component.native());
+  }
+  if (names.empty()) {
+    return std::unexpected(std::format("invalid path '{}'", relative_path.c_str()));
+  }
+
+  int dir_fd = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd == -1) {
+    return std::unexpected(std::strerror(errno));
+  }
+  auto const fail = [&dir_fd](int error) -> std::expected<void, std::string> {
+    ::close(dir_fd);
+    return std::unexpected(error == ELOOP || error == ENOTDIR ? "path contains symlink" : std::strerror(error));
+  };
+
+  for (std::size_t i = 0; i + 1 < names.size(); ++i) {
+    int next_fd = ::openat(dir_fd, names[i].c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (next_fd == -1 && errno == ENOENT) {
+      if (::mkdirat(dir_fd, names[i].c_str(), 0755) == -1 && errno != EEXIST) {
+        return fail(errno);
+      }
+      if (owner && ::fchownat(dir_fd, names[i].c_str(), owner->uid, owner->gid, AT_SYMLINK_NOFOLLOW) == -1) {
+        return fail(errno);
+      }
+      next_fd = ::openat(dir_fd, names[i].c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    if (next_fd == -1) {
+      return fail(errno);
+    }
+    ::close(dir_fd);
+    dir_fd = next_fd;
+  }
+
+  auto const temp_name = names.back() + "." + make_random_name();
+  int const fd = ::openat(dir_fd, temp_name.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    return fail(errno);
+  }
+  int error = 0;
+  if (owner && ::fchown(fd, owner->uid, owner->gid) == -1) {
+    error = errno;
+  }
+  for (std::size_t offset = 0; error == 0 && offset < content.size();) {
+    auto const rc = ::write(fd, content.data() + offset, content.size() - offset);
+    if (rc == -1) {
+      if (errno != EINTR) {
+        error = errno;
+      }
+      continue;
+    }
+    offset += static_cast<std::size_t>(rc);
+  }
+  if (::close(fd) == -1 && error == 0) {
+    error = errno;
+  }
+  // rename replaces symlink at destination name itself, it's never followed
+  if (error == 0 && ::renameat(dir_fd, temp_name.c_str(), dir_fd, names.back().c_str()) == -1) {
+    error = errno;
+  }
+  if (error != 0) {
+    ::unlinkat(dir_fd, temp_name.c_str(), 0);
+    return fail(error);
+  }
+  ::close(dir_fd);
+  return {};
+}
+
+/// Exclusive advisory lock (flock(2)) of file or directory, released on destruction
+export class file_lock {
+private:
+  int fd_ = -1;
+
+  explicit file_lock(int fd) noexcept : fd_(fd) {}
+
+public:
+  file_lock(file_lock const&) = delete;
+  file_lock& operator=(file_lock const&) = delete;
+
+  file_lock(file_lock&& other) noexcept : fd_(std::exchange(other.fd_, -1)) {}
+
+  file_lock& operator=(file_lock&& other) noexcept {
+    if (this != &other) {
+      if (fd_ != -1) {
+        ::close(fd_);
+      }
+      fd_ = std::exchange(other.fd_, -1);
+    }
+    return *this;
+  }
+
+  ~file_lock() {
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+  }
+
+  /// Wait for lock of path
+  [[nodiscard]] static auto acquire(std::filesystem::path const& path) -> std::expected<file_lock, std::string> {
+    int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      return std::unexpected(std::strerror(errno));
+    }
+    while (::flock(fd, LOCK_EX) == -1) {
+      if (errno != EINTR) {
+        auto const error = errno;
+        ::close(fd);
+        return std::unexpected(std::strerror(error));
+      }
+    }
+    return file_lock(fd);
+  }
+};
+
+/// Replace leading "~/" of path with home_path
+export auto expand_tilda(std::filesystem::path& path, std::filesystem::path const& home_path) -> void {
   if (auto const& str = path.native(); str.starts_with("~/")) {
+    path = home_path / std::string_view(str).substr(2);
+  }
+}
+
+export auto expand_tilda(std::filesystem::path& path) -> std::expected<void, std::string> {
+  if (path.native().starts_with("~/")) {
     auto home_path = get_home_path();
     if (!home_path.has_value()) {
       return std::unexpected(home_path.error());
     }
-    path = home_path.value() / std::string_view(str).substr(2);
+    expand_tilda(path, home_path.value());
   }
   return {};
 }
@@ -0,0 +1,45 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+#include <filesystem>
+
+#include <doctest/doctest.h>
+
+import walng.utils;
+
+TEST_CASE("write beneath root creates directories and replaces file") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-utils-test-" + walng::make_random_name());
+  std::filesystem::create_directories(root);
+
+  REQUIRE(walng::write_file_beneath(root, ".config/app/colors", "first"));
+  CHECK(walng::read_file(root / ".config/app/colors").value() == "first");
+  REQUIRE(walng::write_file_beneath(root, ".config/app/colors", "second"));
+  CHECK(walng::read_file(root / ".config/app/colors").value() == "second");
+
+  CHECK_FALSE(walng::write_file_beneath(root, "../colors", "escape"));
+  CHECK_FALSE(walng::write_file_beneath(root, "", "empty"));
+
+  std::filesystem::remove_all(root);
+}
+
+TEST_CASE("write beneath root doesn't follow symlinks") {
+  auto const root = std::filesystem::temp_directory_path() / ("walng-utils-test-" + walng::make_random_name());
+  std::filesystem::create_directories(root / "tenant");
+  std::filesystem::create_directories(root / "outside");
+  REQUIRE(walng::write_file(root / "outside" / "secret", "secret"));
+
+  std::filesystem::create_directory_symlink(root / "outside", root / "tenant" / "dir");
+  auto const rc = walng::write_file_beneath(root / "tenant", "dir/colors", "colors");
+  REQUIRE_FALSE(rc);
+  CHECK(rc.error() == "path contains symlink");
+  CHECK_FALSE(std::filesystem::exists(root / "outside" / "colors"));
+
+  // symlink at target name is replaced, its destination is kept
+  std::filesystem::create_symlink(root / "outside" / "secret", root / "tenant" / "colors");
+  REQUIRE(walng::write_file_beneath(root / "tenant", "colors", "colors"));
+  CHECK(walng::read_file(root / "outside" / "secret").value() == "secret");
+  CHECK_FALSE(std::filesystem::is_symlink(root / "tenant" / "colors"));
+  CHECK(walng::read_file(root / "tenant" / "colors").value() == "colors");
+
+  std::filesystem::remove_all(root);
+}
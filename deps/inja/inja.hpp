@@ -74,7 +74,9 @@ using json = INJA_DATA_TYPE;
 
 #include <map>
 #include <memory>
+#include <memory_resource>
 #include <string>
+#include <utility>
 
 // #include "node.hpp"
 #ifndef INCLUDE_INJA_NODE_HPP_
@@ -805,6 +807,8 @@ namespace inja {
  * \brief The main inja Template.
  */
 struct Template {
+  /// Bump arena of AST nodes, shared by copies of the template. Declared first, so nodes are released before it.
+  std::shared_ptr<std::pmr::monotonic_buffer_resource> arena {std::make_shared<std::pmr::monotonic_buffer_resource>()};
   BlockNode root;
   std::string content;
   std::map<std::string, std::shared_ptr<BlockStatementNode>> block_storage;
@@ -812,6 +816,35 @@ struct Template {
   explicit Template() {}
   explicit Template(const std::string& content): content(content) {}
 
+  Template(const Template&) = default;
+  Template(Template&&) = default;
+
+  // nodes of the previous content have to be released before its arena
+  Template& operator=(const Template& other) {
+    if (this != &other) {
+      block_storage = other.block_storage;
+      root = other.root;
+      content = other.content;
+      arena = other.arena;
+    }
+    return *this;
+  }
+
+  Template& operator=(Template&& other) noexcept {
+    if (this != &other) {
+      block_storage = std::move(other.block_storage);
+      root = std::move(other.root);
+      content = std::move(other.content);
+      arena = std::move(other.arena);
+    }
+    return *this;
+  }
+
+  /// Allocate AST node in the template arena
+  template <class T, class... Args> std::shared_ptr<T> make_node(Args&&... args) const {
+    return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(arena.get()), std::forward<Args>(args)...);
+  }
+
   /// Return number of variables (total number, not distinct ones) in the template
   int count_variables() const {
     auto statistic_visitor = StatisticsVisitor();
@@ -848,6 +881,7 @@ struct LexerConfig {
   std::string comment_close {"#}"};
   std::string comment_close_force_rstrip {"-#}"};
   std::string open_chars {"#{"};
+  std::string open_pairs {"##{%{{{#"};
 
   bool trim_blocks {false};
   bool lstrip_blocks {false};
@@ -878,6 +912,23 @@ struct LexerConfig {
     if (open_chars.find(comment_open_force_lstrip[0]) == std::string::npos) {
       open_chars += comment_open_force_lstrip[0];
     }
+
+    // First two characters of every opening sequence, empty if some sequence is shorter (then only open_chars are used)
+    open_pairs = "";
+    for (const std::string* open : {&line_statement, &statement_open, &statement_open_no_lstrip, &statement_open_force_lstrip, &expression_open,
+                                    &expression_open_force_lstrip, &comment_open, &comment_open_force_lstrip}) {
+      if (open->size() < 2) {
+        open_pairs = "";
+        return;
+      }
+      bool found = false;
+      for (size_t i = 0; i < open_pairs.size(); i += 2) {
+        found = found || (open_pairs[i] == (*open)[0] && open_pairs[i + 1] == (*open)[1]);
+      }
+      if (!found) {
+        open_pairs.append(*open, 0, 2);
+      }
+    }
   }
 };
 
@@ -888,6 +939,10 @@ struct ParserConfig {
   bool search_included_templates_in_files {true};
 
   std::function<Template(const std::string&, const std::string&)> include_callback;
+
+  // Loader of included files, called with file path and function parsing the file instead of reading it.
+  // Consulted for every include, so it may replace outdated templates; takes precedence over include_callback.
+  std::function<Template(const std::string&, const std::function<Template()>&)> include_loader;
 };
 
 /*!
@@ -936,6 +991,12 @@ struct RenderConfig {
 #include <cstddef>
 #include <string_view>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // #include "config.hpp"
 
 // #include "exceptions.hpp"
@@ -1021,6 +1082,53 @@ struct Token {
 
 namespace inja {
 
+/*!
+ * \brief Finds first position of text where one of two-character sequences (concatenated in pairs) starts.
+ *
+ * Text between template tags usually contains lots of single open characters (`{` in CSS, `#` in colors), so candidates
+ * are matched by both characters at once, 32 (AVX2) or 16 (SSE2) positions per step.
+ */
+inline size_t find_first_pair(std::string_view text, std::string_view pairs) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  for (; i + 33 <= text.size(); i += 32) {
+    const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + i));
+    const __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + i + 1));
+    __m256i matches = _mm256_setzero_si256();
+    for (size_t p = 0; p + 1 < pairs.size(); p += 2) {
+      const __m256i first_match = _mm256_cmpeq_epi8(first, _mm256_set1_epi8(pairs[p]));
+      const __m256i second_match = _mm256_cmpeq_epi8(second, _mm256_set1_epi8(pairs[p + 1]));
+      matches = _mm256_or_si256(matches, _mm256_and_si256(first_match, second_match));
+    }
+    if (const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(matches)); mask != 0) {
+      return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+  }
+#elif defined(__SSE2__)
+  for (; i + 17 <= text.size(); i += 16) {
+    const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i));
+    const __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + i + 1));
+    __m128i matches = _mm_setzero_si128();
+    for (size_t p = 0; p + 1 < pairs.size(); p += 2) {
+      const __m128i first_match = _mm_cmpeq_epi8(first, _mm_set1_epi8(pairs[p]));
+      const __m128i second_match = _mm_cmpeq_epi8(second, _mm_set1_epi8(pairs[p + 1]));
+      matches = _mm_or_si128(matches, _mm_and_si128(first_match, second_match));
+    }
+    if (const auto mask = static_cast<unsigned>(_mm_movemask_epi8(matches)); mask != 0) {
+      return i + static_cast<size_t>(__builtin_ctz(mask));
+    }
+  }
+#endif
+  for (; i + 1 < text.size(); ++i) {
+    for (size_t p = 0; p + 1 < pairs.size(); p += 2) {
+      if (text[i] == pairs[p] && text[i + 1] == pairs[p + 1]) {
+        return i;
+      }
+    }
+  }
+  return std::string_view::npos;
+}
+
 /*!
  * \brief Class for lexing an inja Template.
  */
@@ -1314,8 +1422,9 @@ public:
     switch (state) {
     default:
     case State::Text: {
-      // fast-scan to first open character
-      const size_t open_start = m_in.substr(pos).find_first_of(config.open_chars);
+      // fast-scan to first open sequence candidate
+      const size_t open_start =
+          config.open_pairs.empty() ? m_in.substr(pos).find_first_of(config.open_chars) : find_first_pair(m_in.substr(pos), config.open_pairs);
       if (open_start == std::string_view::npos) {
         // didn't find open, return remaining text as text token
         pos = m_in.size();
@@ -1501,9 +1610,9 @@ class Parser {
     }
   }
 
-  inline void add_literal(Arguments &arguments, const char* content_ptr) {
+  inline void add_literal(Arguments &arguments, const Template& tmpl) {
     const std::string_view data_text(literal_start.data(), tok.text.data() - literal_start.data() + tok.text.size());
-    arguments.emplace_back(std::make_shared<LiteralNode>(data_text, data_text.data() - content_ptr));
+    arguments.emplace_back(tmpl.make_node<LiteralNode>(data_text, data_text.data() - tmpl.content.c_str()));
   }
 
   inline void add_operator(Arguments &arguments, OperatorStack &operator_stack) {
@@ -1536,6 +1645,16 @@ class Parser {
         template_name.erase(0, 2);
       }
 
+      if (config.include_loader) {
+        auto include_template = config.include_loader(template_name, [this, &template_name] {
+          auto result = Template(load_file(template_name));
+          parse_into_template(result, template_name);
+          return result;
+        });
+        template_storage.insert_or_assign(template_name, std::move(include_template));
+        return;
+      }
+
       if (template_storage.find(template_name) == template_storage.end()) {
         // Load file
         std::ifstream file;
@@ -1590,13 +1709,13 @@ class Parser {
       case Token::Kind::String: {
         if (current_brace_level == 0 && current_bracket_level == 0) {
           literal_start = tok.text;
-          add_literal(arguments, tmpl.content.c_str());
+          add_literal(arguments, tmpl);
         }
       } break;
       case Token::Kind::Number: {
         if (current_brace_level == 0 && current_bracket_level == 0) {
           literal_start = tok.text;
-          add_literal(arguments, tmpl.content.c_str());
+          add_literal(arguments, tmpl);
         }
       } break;
       case Token::Kind::LeftBracket: {
@@ -1618,7 +1737,7 @@ class Parser {
 
         current_bracket_level -= 1;
         if (current_brace_level == 0 && current_bracket_level == 0) {
-          add_literal(arguments, tmpl.content.c_str());
+          add_literal(arguments, tmpl);
         }
       } break;
       case Token::Kind::RightBrace: {
@@ -1628,7 +1747,7 @@ class Parser {
 
         current_brace_level -= 1;
         if (current_brace_level == 0 && current_bracket_level == 0) {
-          add_literal(arguments, tmpl.content.c_str());
+          add_literal(arguments, tmpl);
         }
       } break;
       case Token::Kind::Id: {
@@ -1639,7 +1758,7 @@ class Parser {
             tok.text == static_cast<decltype(tok.text)>("null")) {
           if (current_brace_level == 0 && current_bracket_level == 0) {
             literal_start = tok.text;
-            add_literal(arguments, tmpl.content.c_str());
+            add_literal(arguments, tmpl);
           }
 
           // Operator
@@ -1648,7 +1767,7 @@ class Parser {
 
           // Functions
         } else if (peek_tok.kind == Token::Kind::LeftParen) {
-          auto func = std::make_shared<FunctionNode>(tok.text, tok.text.data() - tmpl.content.c_str());
+          auto func = tmpl.make_node<FunctionNode>(tok.text, tok.text.data() - tmpl.content.c_str());
           get_next_token();
           do {
             get_next_token();
@@ -1675,7 +1794,7 @@ class Parser {
 
           // Variables
         } else {
-          arguments.emplace_back(std::make_shared<DataNode>(static_cast<std::string>(tok.text), tok.text.data() - tmpl.content.c_str()));
+          arguments.emplace_back(tmpl.make_node<DataNode>(static_cast<std::string>(tok.text), tok.text.data() - tmpl.content.c_str()));
         }
 
         // Operators
@@ -1753,7 +1872,7 @@ class Parser {
           throw_parser_error("unknown operator in parser.");
         }
         }
-        auto function_node = std::make_shared<FunctionNode>(operation, tok.text.data() - tmpl.content.c_str());
+        auto function_node = tmpl.make_node<FunctionNode>(operation, tok.text.data() - tmpl.content.c_str());
 
         while (!operator_stack.empty() &&
                ((operator_stack.top()->precedence > function_node->precedence) ||
@@ -1792,7 +1911,7 @@ class Parser {
         if (tok.kind != Token::Kind::Id) {
           throw_parser_error("expected function name, got '" + tok.describe() + "'");
         }
-        auto func = std::make_shared<FunctionNode>(tok.text, tok.text.data() - tmpl.content.c_str());
+        auto func = tmpl.make_node<FunctionNode>(tok.text, tok.text.data() - tmpl.content.c_str());
         // add first parameter as last value from arguments
         func->number_args += 1;
         func->arguments.emplace_back(arguments.back());
@@ -1855,7 +1974,7 @@ class Parser {
     if (tok.text == static_cast<decltype(tok.text)>("if")) {
       get_next_token();
 
-      auto if_statement_node = std::make_shared<IfStatementNode>(current_block, tok.text.data() - tmpl.content.c_str());
+      auto if_statement_node = tmpl.make_node<IfStatementNode>(current_block, tok.text.data() - tmpl.content.c_str());
       current_block->nodes.emplace_back(if_statement_node);
       if_statement_stack.emplace(if_statement_node.get());
       current_block = &if_statement_node->true_statement;
@@ -1878,7 +1997,7 @@ class Parser {
       if (tok.kind == Token::Kind::Id && tok.text == static_cast<decltype(tok.text)>("if")) {
         get_next_token();
 
-        auto if_statement_node = std::make_shared<IfStatementNode>(true, current_block, tok.text.data() - tmpl.content.c_str());
+        auto if_statement_node = tmpl.make_node<IfStatementNode>(true, current_block, tok.text.data() - tmpl.content.c_str());
         current_block->nodes.emplace_back(if_statement_node);
         if_statement_stack.emplace(if_statement_node.get());
         current_block = &if_statement_node->true_statement;
@@ -1912,7 +2031,7 @@ class Parser {
 
       const std::string block_name = static_cast<std::string>(tok.text);
 
-      auto block_statement_node = std::make_shared<BlockStatementNode>(current_block, block_name, tok.text.data() - tmpl.content.c_str());
+      auto block_statement_node = tmpl.make_node<BlockStatementNode>(current_block, block_name, tok.text.data() - tmpl.content.c_str());
       current_block->nodes.emplace_back(block_statement_node);
       block_statement_stack.emplace(block_statement_node.get());
       current_block = &block_statement_node->block;
@@ -1955,13 +2074,13 @@ class Parser {
         value_token = tok;
         get_next_token();
 
-        for_statement_node = std::make_shared<ForObjectStatementNode>(static_cast<std::string>(key_token.text), static_cast<std::string>(value_token.text),
+        for_statement_node = tmpl.make_node<ForObjectStatementNode>(static_cast<std::string>(key_token.text), static_cast<std::string>(value_token.text),
                                                                       current_block, tok.text.data() - tmpl.content.c_str());
 
         // Array type
       } else {
         for_statement_node =
-            std::make_shared<ForArrayStatementNode>(static_cast<std::string>(value_token.text), current_block, tok.text.data() - tmpl.content.c_str());
+            tmpl.make_node<ForArrayStatementNode>(static_cast<std::string>(value_token.text), current_block, tok.text.data() - tmpl.content.c_str());
       }
 
       current_block->nodes.emplace_back(for_statement_node);
@@ -1993,7 +2112,7 @@ class Parser {
       std::string template_name = parse_filename();
       add_to_template_storage(path, template_name);
 
-      current_block->nodes.emplace_back(std::make_shared<IncludeStatementNode>(template_name, tok.text.data() - tmpl.content.c_str()));
+      current_block->nodes.emplace_back(tmpl.make_node<IncludeStatementNode>(template_name, tok.text.data() - tmpl.content.c_str()));
 
       get_next_token();
     } else if (tok.text == static_cast<decltype(tok.text)>("extends")) {
@@ -2002,7 +2121,7 @@ class Parser {
       std::string template_name = parse_filename();
       add_to_template_storage(path, template_name);
 
-      current_block->nodes.emplace_back(std::make_shared<ExtendsStatementNode>(template_name, tok.text.data() - tmpl.content.c_str()));
+      current_block->nodes.emplace_back(tmpl.make_node<ExtendsStatementNode>(template_name, tok.text.data() - tmpl.content.c_str()));
 
       get_next_token();
     } else if (tok.text == static_cast<decltype(tok.text)>("set")) {
@@ -2015,7 +2134,7 @@ class Parser {
       const std::string key = static_cast<std::string>(tok.text);
       get_next_token();
 
-      auto set_statement_node = std::make_shared<SetStatementNode>(key, tok.text.data() - tmpl.content.c_str());
+      auto set_statement_node = tmpl.make_node<SetStatementNode>(key, tok.text.data() - tmpl.content.c_str());
       current_block->nodes.emplace_back(set_statement_node);
       current_expression_list = &set_statement_node->expression;
 
@@ -2050,7 +2169,7 @@ class Parser {
       }
         return;
       case Token::Kind::Text: {
-        current_block->nodes.emplace_back(std::make_shared<TextNode>(tok.text.data() - tmpl.content.c_str(), tok.text.size()));
+        current_block->nodes.emplace_back(tmpl.make_node<TextNode>(tok.text.data() - tmpl.content.c_str(), tok.text.size()));
       } break;
       case Token::Kind::StatementOpen: {
         get_next_token();
@@ -2073,7 +2192,7 @@ class Parser {
       case Token::Kind::ExpressionOpen: {
         get_next_token();
 
-        auto expression_list_node = std::make_shared<ExpressionListNode>(tok.text.data() - tmpl.content.c_str());
+        auto expression_list_node = tmpl.make_node<ExpressionListNode>(tok.text.data() - tmpl.content.c_str());
         current_block->nodes.emplace_back(expression_list_node);
         current_expression_list = expression_list_node.get();
 
@@ -2138,6 +2257,7 @@ public:
 #include <cmath>
 #include <cstddef>
 #include <memory>
+#include <memory_resource>
 #include <numeric>
 #include <ostream>
 #include <sstream>
@@ -2166,6 +2286,20 @@ namespace inja {
 /*!
  * \brief Class for rendering a Template with data.
  */
+/*!
+ * \brief Typed data access for the renderer.
+ *
+ * Data nodes are resolved through the provider before the json data input, so
+ * applications can serve their variables without json object lookups. Returned
+ * value must stay valid until rendering is finished; nullptr means not provided.
+ */
+class DataProvider {
+public:
+  virtual ~DataProvider() = default;
+
+  virtual const json* resolve(const DataNode& node) const = 0;
+};
+
 class Renderer : public NodeVisitor {
   using Op = FunctionStorage::Operation;
 
@@ -2179,16 +2313,34 @@ class Renderer : public NodeVisitor {
   std::vector<const BlockStatementNode*> block_statement_stack;
 
   const json* data_input;
-  std::ostream* output_stream;
+  const DataProvider* data_provider {nullptr};
+  std::string* output;
 
   json additional_data;
   json* current_loop_data = &additional_data["loop"];
 
-  std::vector<std::shared_ptr<json>> data_tmp_stack;
+  /// Arena of evaluation temporaries, small renders are served from the inline buffer without heap allocations
+  std::array<std::byte, 2048> tmp_buffer;
+  std::pmr::monotonic_buffer_resource tmp_arena {tmp_buffer.data(), tmp_buffer.size()};
+  /// Temporaries dropped by loop iterations are reused by next ones instead of growing the arena
+  std::pmr::unsynchronized_pool_resource tmp_pool {&tmp_arena};
+
+  std::pmr::vector<std::shared_ptr<json>> data_tmp_stack {&tmp_pool};
   std::stack<const json*> data_eval_stack;
   std::stack<const DataNode*> not_found_stack;
 
   bool break_rendering {false};
+  /// Nesting of render_into, parent templates of extends are rendered by the same renderer
+  size_t render_depth {0};
+
+  template <class... Args> std::shared_ptr<json> make_tmp(Args&&... args) {
+    return std::allocate_shared<json>(std::pmr::polymorphic_allocator<json>(&tmp_pool), std::forward<Args>(args)...);
+  }
+
+  /// Drop temporaries created after the stack had given size, evaluated values referring to them must be unused
+  void release_tmp(size_t size) {
+    data_tmp_stack.erase(data_tmp_stack.begin() + static_cast<std::ptrdiff_t>(size), data_tmp_stack.end());
+  }
 
   static bool truthy(const json* data) {
     if (data->is_boolean()) {
@@ -2217,24 +2369,29 @@ class Renderer : public NodeVisitor {
     return buffer;
   }
 
-  void print_data(const std::shared_ptr<json>& value) {
-    if (value->is_string()) {
+  void print_data(const json& value) {
+    if (value.is_string()) {
       if (config.html_autoescape) {
-        *output_stream << htmlescape(value->get_ref<const json::string_t&>());
+        output->append(htmlescape(value.get_ref<const json::string_t&>()));
       } else {
-        *output_stream << value->get_ref<const json::string_t&>();
+        output->append(value.get_ref<const json::string_t&>());
       }
-    } else if (value->is_number_unsigned()) {
-      *output_stream << value->get<const json::number_unsigned_t>();
-    } else if (value->is_number_integer()) {
-      *output_stream << value->get<const json::number_integer_t>();
-    } else if (value->is_null()) {
+    } else if (value.is_number_unsigned()) {
+      output->append(std::to_string(value.get<const json::number_unsigned_t>()));
+    } else if (value.is_number_integer()) {
+      output->append(std::to_string(value.get<const json::number_integer_t>()));
+    } else if (value.is_null()) {
     } else {
-      *output_stream << value->dump();
+      output->append(value.dump());
     }
   }
 
   const std::shared_ptr<json> eval_expression_list(const ExpressionListNode& expression_list) {
+    return make_tmp(*eval_expression_list_ref(expression_list));
+  }
+
+  // Result is owned by data input, provider or data_tmp_stack, valid until additional data changes
+  const json* eval_expression_list_ref(const ExpressionListNode& expression_list) {
     if (!expression_list.root) {
       throw_renderer_error("empty expression", expression_list);
     }
@@ -2260,7 +2417,7 @@ class Renderer : public NodeVisitor {
 
       throw_renderer_error("variable '" + static_cast<std::string>(node->name) + "' not found", *node);
     }
-    return std::make_shared<json>(*result);
+    return result;
   }
 
   void throw_renderer_error(const std::string& message, const AstNode& node) {
@@ -2269,7 +2426,7 @@ class Renderer : public NodeVisitor {
   }
 
   void make_result(const json&& result) {
-    auto result_ptr = std::make_shared<json>(result);
+    auto result_ptr = make_tmp(result);
     data_tmp_stack.push_back(result_ptr);
     data_eval_stack.push(result_ptr.get());
   }
@@ -2342,7 +2499,7 @@ class Renderer : public NodeVisitor {
   }
 
   void visit(const TextNode& node) {
-    output_stream->write(current_template->content.c_str() + node.pos, node.length);
+    output->append(current_template->content, node.pos, node.length);
   }
 
   void visit(const ExpressionNode&) {}
@@ -2352,8 +2509,11 @@ class Renderer : public NodeVisitor {
   }
 
   void visit(const DataNode& node) {
+    const json* provided = nullptr;
     if (additional_data.contains(node.ptr)) {
       data_eval_stack.push(&(additional_data[node.ptr]));
+    } else if (data_provider && (provided = data_provider->resolve(node))) {
+      data_eval_stack.push(provided);
     } else if (data_input->contains(node.ptr)) {
       data_eval_stack.push(&(*data_input)[node.ptr]);
     } else {
@@ -2361,7 +2521,7 @@ class Renderer : public NodeVisitor {
       const auto function_data = function_storage.find_function(node.name, 0);
       if (function_data.operation == FunctionStorage::Operation::Callback) {
         Arguments empty_args {};
-        const auto value = std::make_shared<json>(function_data.callback(empty_args));
+        const auto value = make_tmp(function_data.callback(empty_args));
         data_tmp_stack.push_back(value);
         data_eval_stack.push(value.get());
       } else {
@@ -2560,7 +2720,7 @@ class Renderer : public NodeVisitor {
       }
     } break;
     case Op::Sort: {
-      auto result_ptr = std::make_shared<json>(get_arguments<1>(node)[0]->get<std::vector<json>>());
+      auto result_ptr = make_tmp(get_arguments<1>(node)[0]->get<std::vector<json>>());
       std::sort(result_ptr->begin(), result_ptr->end());
       data_tmp_stack.push_back(result_ptr);
       data_eval_stack.push(result_ptr.get());
@@ -2646,7 +2806,7 @@ class Renderer : public NodeVisitor {
   }
 
   void visit(const ExpressionListNode& node) {
-    print_data(eval_expression_list(node));
+    print_data(*eval_expression_list_ref(node));
   }
 
   void visit(const StatementNode&) {}
@@ -2664,6 +2824,8 @@ class Renderer : public NodeVisitor {
       (*current_loop_data)["parent"] = std::move(tmp);
     }
 
+    // temporaries of an iteration are dropped before the next one, result of condition is kept
+    const auto tmp_size = data_tmp_stack.size();
     size_t index = 0;
     (*current_loop_data)["is_first"] = true;
     (*current_loop_data)["is_last"] = (result->size() <= 1);
@@ -2680,6 +2842,7 @@ class Renderer : public NodeVisitor {
       }
 
       node.body.accept(*this);
+      release_tmp(tmp_size);
       ++index;
     }
 
@@ -2702,6 +2865,8 @@ class Renderer : public NodeVisitor {
       (*current_loop_data)["parent"] = std::move(*current_loop_data);
     }
 
+    // temporaries of an iteration are dropped before the next one, result of condition is kept
+    const auto tmp_size = data_tmp_stack.size();
     size_t index = 0;
     (*current_loop_data)["is_first"] = true;
     (*current_loop_data)["is_last"] = (result->size() <= 1);
@@ -2719,6 +2884,7 @@ class Renderer : public NodeVisitor {
       }
 
       node.body.accept(*this);
+      release_tmp(tmp_size);
       ++index;
     }
 
@@ -2732,8 +2898,8 @@ class Renderer : public NodeVisitor {
   }
 
   void visit(const IfStatementNode& node) {
-    const auto result = eval_expression_list(node.condition);
-    if (truthy(result.get())) {
+    const auto result = eval_expression_list_ref(node.condition);
+    if (truthy(result)) {
       node.true_statement.accept(*this);
     } else if (node.has_false_statement) {
       node.false_statement.accept(*this);
@@ -2742,9 +2908,10 @@ class Renderer : public NodeVisitor {
 
   void visit(const IncludeStatementNode& node) {
     auto sub_renderer = Renderer(config, template_storage, function_storage);
+    sub_renderer.data_provider = data_provider;
     const auto included_template_it = template_storage.find(node.file);
     if (included_template_it != template_storage.end()) {
-      sub_renderer.render_to(*output_stream, included_template_it->second, *data_input, &additional_data);
+      sub_renderer.render_into(*output, included_template_it->second, *data_input, &additional_data);
     } else if (config.throw_at_missing_includes) {
       throw_renderer_error("include '" + node.file + "' not found", node);
     }
@@ -2754,7 +2921,7 @@ class Renderer : public NodeVisitor {
     const auto included_template_it = template_storage.find(node.file);
     if (included_template_it != template_storage.end()) {
       const Template* parent_template = &included_template_it->second;
-      render_to(*output_stream, *parent_template, *data_input, &additional_data);
+      render_into(*output, *parent_template, *data_input, &additional_data);
       break_rendering = true;
     } else if (config.throw_at_missing_includes) {
       throw_renderer_error("extends '" + node.file + "' not found", node);
@@ -2786,8 +2953,13 @@ public:
   Renderer(const RenderConfig& config, const TemplateStorage& template_storage, const FunctionStorage& function_storage)
       : config(config), template_storage(template_storage), function_storage(function_storage) {}
 
-  void render_to(std::ostream& os, const Template& tmpl, const json& data, json* loop_data = nullptr) {
-    output_stream = &os;
+  void set_data_provider(const DataProvider* provider) {
+    data_provider = provider;
+  }
+
+  /// Append rendered template to output string, no stream is involved
+  void render_into(std::string& os, const Template& tmpl, const json& data, json* loop_data = nullptr) {
+    output = &os;
     current_template = &tmpl;
     data_input = &data;
     if (loop_data) {
@@ -2796,9 +2968,27 @@ public:
     }
 
     template_stack.emplace_back(current_template);
-    current_template->root.accept(*this);
+    ++render_depth;
+    try {
+      current_template->root.accept(*this);
+    } catch (...) {
+      --render_depth;
+      throw;
+    }
+
+    // nothing refers to temporaries once the outermost render is done, give memory of the render back; nested (extends)
+    // renders keep them, loops of outer frames still use them
+    if (--render_depth == 0) {
+      std::pmr::vector<std::shared_ptr<json>>(&tmp_pool).swap(data_tmp_stack);
+      tmp_pool.release();
+      tmp_arena.release();
+    }
+  }
 
-    data_tmp_stack.clear();
+  void render_to(std::ostream& os, const Template& tmpl, const json& data, json* loop_data = nullptr) {
+    std::string buffer;
+    render_into(buffer, tmpl, data, loop_data);
+    os.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
   }
 };
 
@@ -2913,9 +3103,23 @@ public:
   }
 
   std::string render(const Template& tmpl, const json& data) {
-    std::stringstream os;
-    render_to(os, tmpl, data);
-    return os.str();
+    std::string result;
+    render_into(result, tmpl, data);
+    return result;
+  }
+
+  std::string render(const Template& tmpl, const json& data, const DataProvider& provider) {
+    std::string result;
+    render_into(result, tmpl, data, &provider);
+    return result;
+  }
+
+  /// Append rendered template to output, a reused output keeps its capacity between renders
+  std::string& render_into(std::string& output, const Template& tmpl, const json& data, const DataProvider* provider = nullptr) {
+    Renderer renderer(render_config, template_storage, function_storage);
+    renderer.set_data_provider(provider);
+    renderer.render_into(output, tmpl, data);
+    return output;
   }
 
   std::string render_file(const std::string& filename, const json& data) {
@@ -2928,14 +3132,13 @@ public:
   }
 
   void write(const std::string& filename, const json& data, const std::string& filename_out) {
-    std::ofstream file(output_path + filename_out);
-    file << render_file(filename, data);
-    file.close();
+    write(parse_template(filename), data, filename_out);
   }
 
   void write(const Template& temp, const json& data, const std::string& filename_out) {
-    std::ofstream file(output_path + filename_out);
-    file << render(temp, data);
+    const std::string content = render(temp, data);
+    std::ofstream file(output_path + filename_out, std::ios::binary);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
     file.close();
   }
 
@@ -2954,6 +3157,13 @@ public:
     return os;
   }
 
+  std::ostream& render_to(std::ostream& os, const Template& tmpl, const json& data, const DataProvider& provider) {
+    Renderer renderer(render_config, template_storage, function_storage);
+    renderer.set_data_provider(&provider);
+    renderer.render_to(os, tmpl, data);
+    return os;
+  }
+
   std::ostream& render_to(std::ostream& os, const std::string_view input, const json& data) {
     return render_to(os, parse(input), data);
   }
@@ -3018,6 +3228,13 @@ public:
   void set_include_callback(const std::function<Template(const std::string&, const std::string&)>& callback) {
     parser_config.include_callback = callback;
   }
+
+  /*!
+  @brief Sets loader of included files, e.g. to share parsed templates between parses
+  */
+  void set_include_loader(const std::function<Template(const std::string&, const std::function<Template()>&)>& loader) {
+    parser_config.include_loader = loader;
+  }
 };
 
 /*!
@@ -0,0 +1,353 @@
+// Copyright (c) Sergey Kovalevich <inndie@gmail.com>
+// SPDX-License-Identifier: AGPL-3.0
+
+// Build-time compiler of templates/ into C++ render functions of walng.builtin_templates module
+// Usage: walng-template-compiler <output.cpp> <template>...
+
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <ostream>
+#include <print>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <inja/inja.hpp>
+
+namespace {
+
+/// Callbacks of walng templates, must match walng::get_template_callbacks()
+constexpr std::pair<std::string_view, int> template_callbacks[] = {
+    {"hex", 1}, {"rgb", 1}, {"r", 1}, {"g", 1}, {"b", 1}, {"alpha", 2}, {"rgba", 1}};
+
+constexpr std::string_view field_names[] = {"palette", "name", "author", "variant", "system"};
+
+auto escape_string(std::string_view str) -> std::string {
+  std::string result = "\"";
+  for (auto const ch : str) {
+    switch (ch) {
+    case '\\':
+      result += "\\\\";
+      break;
+    case '"':
+      result += "\\\"";
+      break;
+    case '\n':
+      result += "\\n";
+      break;
+    case '\t':
+      result += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(ch) < 0x20) {
+        result += std::format("\\{:03o}", static_cast<unsigned char>(ch));
+      } else {
+        result += ch;
+      }
+      break;
+    }
+  }
+  result += "\"sv";
+  return result;
+}
+
+auto slot_index(std::string_view name) -> int {
+  constexpr std::string_view prefix = "palette.base";
+  if (!name.starts_with(prefix) || name.size() != prefix.size() + 2) {
+    return -1;
+  }
+  auto const index = std::stoi(std::string(name.substr(prefix.size())), nullptr, 16);
+  return index < 24 ? index : -1;
+}
+
+/// Emits C++ statements for template AST, the subset matches walng::template_program
+class template_codegen : public inja::NodeVisitor {
+private:
+  std::string_view content_;
+  std::string declarations_;
+  std::string body_;
+  std::string expression_;
+  std::string error_;
+  std::vector<std::pair<std::string, std::string>> locals_;
+  int indent_ = 1;
+  int depth_ = 0;
+  int constants_ = 0;
+  int callbacks_ = 0;
+
+  void line(std::string_view str) {
+    body_.append(2 * indent_, ' ').append(str).append("\n");
+  }
+
+  void unsupported(std::string_view what) {
+    if (error_.empty()) {
+      error_ = std::format("unsupported {}", what);
+    }
+  }
+
+  auto expression(inja::ExpressionNode const* node) -> std::string {
+    expression_.clear();
+    if (!node) {
+      unsupported("empty expression");
+      return {};
+    }
+    node->accept(*this);
+    return std::exchange(expression_, {});
+  }
+
+public:
+  explicit template_codegen(std::string_view content) : content_(content) {}
+
+  auto error() const noexcept -> std::string const& {
+    return error_;
+  }
+
+  auto function(std::string_view name) const -> std::string {
+    return std::format("auto {}([[maybe_unused]] theme_data_provider const& data, std::string& output) -> void {{\n"
+                       "{}{}}}\n",
+        name, declarations_, body_);
+  }
+
+  void visit(inja::BlockNode const& node) override {
+    for (auto const& child : node.nodes) {
+      child->accept(*this);
+    }
+  }
+
+  void visit(inja::TextNode const& node) override {
+    line(std::format("output.append({});", escape_string(content_.substr(node.pos, node.length))));
+  }
+
+  void visit(inja::ExpressionNode const&) override {
+    unsupported("expression");
+  }
+
+  void visit(inja::LiteralNode const& node) override {
+    auto const name = std::format("constant_{}", constants_++);
+    declarations_ += std::format("  static inja::json const {} = inja::json::parse({});\n", name,
+        escape_string(node.value.dump()));
+    expression_ = name;
+  }
+
+  void visit(inja::DataNode const& node) override {
+    for (auto it = locals_.rbegin(); it != locals_.rend(); ++it) {
+      if (it->first == node.name) {
+        expression_ = it->second;
+        return;
+      }
+    }
+    if (auto const index = slot_index(node.name); index != -1) {
+      expression_ = std::format("detail::get_builtin_slot(data, {})", index);
+      return;
+    }
+    for (std::size_t index = 0; index < std::size(field_names); ++index) {
+      if (field_names[index] == node.name) {
+        expression_ = std::format("*data.field({})", index);
+        return;
+      }
+    }
+    unsupported(std::format("variable '{}'", node.name));
+  }
+
+  void visit(inja::FunctionNode const& node) override {
+    using op = inja::FunctionStorage::Operation;
+    switch (node.operation) {
+    case op::Callback: {
+      auto const name = std::format("callback_{}", callbacks_++);
+      declarations_ += std::format("  static auto const& {} = detail::get_builtin_callback({}, {});\n", name,
+          escape_string(node.name), node.arguments.size());
+      auto result = std::format("detail::call_builtin_callback(data, {}", name);
+      for (auto const& argument : node.arguments) {
+        result += ", " + expression(argument.get());
+      }
+      expression_ = result + ")";
+    } break;
+    case op::Not:
+      expression_ = std::format("inja::json(!is_template_value_truthy({}))", expression(node.arguments.at(0).get()));
+      break;
+    case op::Equal:
+    case op::NotEqual: {
+      auto const lhs = expression(node.arguments.at(0).get());
+      auto const rhs = expression(node.arguments.at(1).get());
+      expression_ =
+          std::format("inja::json(({}) {} ({}))", lhs, node.operation == op::Equal ? "==" : "!=", rhs);
+    } break;
+    default:
+      unsupported(std::format("function '{}'", node.name));
+      break;
+    }
+  }
+
+  void visit(inja::ExpressionListNode const& node) override {
+    line(std::format("append_template_value(output, {});", expression(node.root.get())));
+  }
+
+  void visit(inja::StatementNode const&) override {
+    unsupported("statement");
+  }
+
+  void visit(inja::ForStatementNode const&) override {
+    unsupported("loop");
+  }
+
+  void visit(inja::ForArrayStatementNode const&) override {
+    unsupported("array loop");
+  }
+
+  void visit(inja::ForObjectStatementNode const& node) override {
+    auto const* data = dynamic_cast<inja::DataNode const*>(node.condition.root.get());
+    if (!data || data->name != "palette") {
+      unsupported("loop over anything but palette");
+      return;
+    }
+    auto const depth = depth_++;
+    auto const index = std::format("index_{}", depth);
+    auto const key = std::format("key_{}", depth);
+    auto const value = std::format("value_{}", depth);
+
+    line(std::format("for (std::size_t {} = 0; {} < data.palette_size(); ++{}) {{", index, index, index));
+    ++indent_;
+    line(std::format("[[maybe_unused]] auto const& {} = get_palette_slot_name({});", key, index));
+    line(std::format("[[maybe_unused]] auto const& {} = *data.slot({});", value, index));
+    locals_.emplace_back(node.key, key);
+    locals_.emplace_back(node.value, value);
+    node.body.accept(*this);
+    locals_.resize(locals_.size() - 2);
+    --indent_;
+    line("}");
+    --depth_;
+  }
+
+  void visit(inja::IfStatementNode const& node) override {
+    line(std::format("if (is_template_value_truthy({})) {{", expression(node.condition.root.get())));
+    ++indent_;
+    node.true_statement.accept(*this);
+    --indent_;
+    if (node.has_false_statement) {
+      line("} else {");
+      ++indent_;
+      node.false_statement.accept(*this);
+      --indent_;
+    }
+    line("}");
+  }
+
+  void visit(inja::IncludeStatementNode const&) override {
+    unsupported("include");
+  }
+
+  void visit(inja::ExtendsStatementNode const&) override {
+    unsupported("extends");
+  }
+
+  void visit(inja::BlockStatementNode const&) override {
+    unsupported("block");
+  }
+
+  void visit(inja::SetStatementNode const&) override {
+    unsupported("set");
+  }
+};
+
+/// Parser environment, same settings as walng::get_inja_env()
+auto get_inja_env() -> inja::Environment {
+  inja::Environment result;
+  result.set_trim_blocks(true);
+  result.set_lstrip_blocks(true);
+  for (auto const& [name, argc] : template_callbacks) {
+    result.add_callback(std::string(name), argc, [](inja::Arguments&) {
+      return inja::json();
+    });
+  }
+  return result;
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+  if (argc < 2) {
+    std::print(stderr, "usage: {} <output.cpp> <template>...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  auto env = get_inja_env();
+
+  std::string functions;
+  std::string entries;
+  for (int i = 2; i < argc; ++i) {
+    std::filesystem::path const path = argv[i];
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+      std::print(stderr, "failed to read template '{}'\n", path.c_str());
+      return EXIT_FAILURE;
+    }
+    std::stringstream content;
+    content << input.rdbuf();
+    auto const source = std::move(content).str();
+
+    try {
+      auto const tmpl = env.parse(source);
+      template_codegen codegen(tmpl.content);
+      tmpl.root.accept(codegen);
+      if (!codegen.error().empty()) {
+        std::print(stderr, "failed to compile template '{}' ({})\n", path.c_str(), codegen.error());
+        return EXIT_FAILURE;
+      }
+      auto const function_name = std::format("render_{}", i - 2);
+      functions += codegen.function(function_name) + "\n";
+      entries += std::format("      {{{}, {}, {}}},\n", escape_string(path.filename().string()),
+          escape_string(source), function_name);
+    } catch (std::exception const& e) {
+      std::print(stderr, "failed to parse template '{}' ({})\n", path.c_str(), e.what());
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::ofstream output(argv[1], std::ios::binary | std::ios::trunc);
+  std::print(output,
+      "// Generated by walng-template-compiler, do not edit\n"
+      "\n"
+      "module;\n"
+      "\n"
+      "#include <cstddef>\n"
+      "#include <span>\n"
+      "#include <string>\n"
+      "#include <string_view>\n"
+      "\n"
+      "#include <inja/inja.hpp>\n"
+      "\n"
+      "import walng.render;\n"
+      "\n"
+      "module walng.builtin_templates;\n"
+      "\n"
+      "namespace walng {{\n"
+      "\n"
+      "using namespace std::string_view_literals;\n"
+      "\n"
+      "namespace {{\n"
+      "\n"
+      "{}"
+      "}} // namespace\n"
+      "\n"
+      "auto get_builtin_templates() -> std::span<builtin_template const> {{\n"
+      "{}"
+      "}}\n"
+      "\n"
+      "}} // namespace walng\n",
+      functions,
+      entries.empty() ? std::string("  return {};\n")
+                      : std::format("  static constexpr builtin_template templates[] = {{\n{}  }};\n"
+                                    "  return templates;\n",
+                            entries));
+  if (!output) {
+    std::print(stderr, "failed to write '{}'\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}